@@ -5,11 +5,13 @@ struct Position : public ECS::Component<0>
 {
 	Position(float _x = 0.0f, float _y = 0.0f) : x(_x), y(_y) {}
 	float x, y;
+	MAKE_SOA(Position, x, y);
 };
 struct Movement : public ECS::Component<1>
 {
 	Movement(float _x = 0.0f, float _y = 0.0f) : x(_x), y(_y) {}
 	float x, y;
+	MAKE_SOA(Movement, x, y);
 };
 struct Acceleration : public ECS::Component<2>
 {
@@ -1,48 +1,68 @@
 #include <iostream>
+#include <vector>
 #include <crtdbg.h>
 #include "ECS/ECSManager.hpp"
+#include "ECS/CommandBuffer.hpp"
+#include "ECS/SystemScheduler.hpp"
 #include "Components/ApplicationComponents.hpp"
-#include "Utilities/Timer.hpp"
+#include "Utilities/PerfCounters.hpp"
 #include "Experiments.hpp"
 
-void createCharacter(ECS::ECSManager& em)
+void createCharacters(ECS::ECSManager& em, const size_t count)
 {
-	auto entity = em.createEntity();
-	em.attachComponent<Position>(entity);
-	em.attachComponent<Movement>(entity);
-	em.attachComponent<Acceleration>(entity);
-	em.attachComponent<Gravity>(entity);
+	std::vector<ECS::Entity> entities(count);
+	em.createEntities(count, entities);
+	em.attachComponents<Position>(entities);
+	em.attachComponents<Movement>(entities);
+	em.attachComponents<Acceleration>(entities);
+	em.attachComponents<Gravity>(entities);
 }
 
 void movementSystem(ECS::ECSManager& em, float dt)
 {
 	auto view = em.getView<Movement, Position>();
-	view.for_each_entity([dt](Movement& mov, Position& pos)
+
+	// Whole field arrays can be handed out when the types are grouped, which lets the loop be vectorized
+	const bool isBatched = view.for_each_batch([dt](const size_t count, Movement::SoASpan mov, Position::SoASpan pos)
 		{
-			pos.x += mov.x * dt;
-			pos.y += mov.y * dt;
+			for (size_t i = 0; i < count; i++)
+			{
+				pos.x[i] += mov.x[i] * dt;
+				pos.y[i] += mov.y[i] * dt;
+			}
 		}
 	);
+
+	if (!isBatched)
+	{
+		view.for_each_entity([dt](Movement::SoARef mov, Position::SoARef pos)
+			{
+				pos.x += mov.x * dt;
+				pos.y += mov.y * dt;
+			}
+		);
+	}
 }
-void accelerationSystem(ECS::ECSManager& em, float dt)
+void addCharacterSystems(ECS::SystemScheduler& scheduler)
 {
-	auto view = em.getView<Acceleration, Movement>();
-	view.for_each_entity([dt](Acceleration& acc, Movement& mov)
+	// Both write to movement, meaning that they run after each other, and the movement system after them
+	const size_t acceleration = scheduler.addSystem<Acceleration, Movement>([](const float dt, const Acceleration& acc, Movement::SoARef mov)
 		{
 			mov.x += acc.x * dt;
 			mov.y += acc.y * dt;
 		}
 	);
-}
-void gravitySystem(ECS::ECSManager& em, float dt)
-{
-	auto view = em.getView<Gravity, Movement>();
-	view.for_each_entity([dt](Gravity& grav, Movement& mov)
+	const size_t gravity = scheduler.addSystem<Gravity, Movement>([](const float dt, const Gravity& grav, Movement::SoARef mov)
 		{
 			mov.x += grav.x * dt;
 			mov.y += grav.y * dt;
 		}
 	);
+	const size_t movement = scheduler.addSystem(ECS::Reads<Movement>(), ECS::Writes<Position>(), movementSystem);
+
+	scheduler.setName(acceleration, "Acceleration system");
+	scheduler.setName(gravity, "Gravity system");
+	scheduler.setName(movement, "Movement system");
 }
 
 void commandFiller(ECS::ECSManager& em, [[maybe_unused]] float dt)
@@ -61,34 +81,43 @@ void commandFiller(ECS::ECSManager& em, [[maybe_unused]] float dt)
 	);
 }
 
-void lifeTimeSystem(ECS::ECSManager& em, [[maybe_unused]] float dt)
+void lifeTimeSystem(ECS::ECSManager& em, float dt)
 {
+	ECS::CommandBuffer commandBuffer;
+
 	auto view = em.getView<LifeTime>();
-	view.for_each_entity([dt](LifeTime& lifeTime)
+	view.for_each_entity(ECS::withEntityID([&em, &commandBuffer, dt](const ECS::EntityID entityID, LifeTime& lifeTime)
 		{
-			if (lifeTime.remainingTime -= dt < 0.0f)
+			lifeTime.remainingTime -= dt;
+			if (lifeTime.remainingTime < 0.0f)
 			{
-				// Destroy entity
-				// Validity should be set immediately
-				// Destruction should be queued and not happen immediately
+				// Destroying the entity here would move components under the loop, so it's queued until the loop is done
+				commandBuffer.destroyEntity(em.getEntity(entityID));
 			}
 		}
-	);
+	));
+
+	commandBuffer.playback(em);
 }
 
 
 void test1()
 {
 	ECS::ECSManager em;
+	ECS::SystemScheduler scheduler(em);
 	Timer::TimePoint tp1, tp2;
 
-	for (size_t i = 0; i < 1'000; i++)
-	{
-		createCharacter(em);
-	}
+	// Keeps movement and position components in the same order, for movementSystem
+	em.registerGroup<Movement, Position>();
+
+	createCharacters(em, 1'000);
+	addCharacterSystems(scheduler);
 
 	constexpr float nsToS = 1.0f / static_cast<float>(1e9);
 
+	// Counts cache and branch misses of each system and view where the CPU exposes them, at the cost of a system call per scope
+	//Timer::setCountersEnabled(true);
+
 	Timer::Stopped timer("10'000 iterations");
 	for (size_t i = 0; i < 10'000; i++)
 	{
@@ -96,15 +125,22 @@ void test1()
 		tp2 = Timer::Clock::now();
 		const float dt = (tp2 - tp1).count() * nsToS;
 
-		accelerationSystem(em, dt);
-		gravitySystem(em, dt);
-		movementSystem(em, dt);
+		scheduler.run(dt);
+		Timer::endFrame();
 	}
 	timer.stop();
+	Timer::endFrame();
 
-	for (auto& [label, time] : Timer::getStorage())
+	for (const Timer::Stats& stats : Timer::report())
 	{
-		std::cout << label << ": " << static_cast<double>(time) / 1e6 << "ms\n";
+		std::cout << stats.label << ": " << stats.totalMs << "ms (" << stats.frames << " frames, average " << stats.averageMs << "ms, p99 " << stats.p99Ms << "ms)\n";
+		if (stats.countedScopes > 0)
+		{
+			using Timer::Counter;
+			const auto count = [&stats](const Counter counter) { return stats.counters[static_cast<size_t>(counter)]; };
+			std::cout << "\tper " << (stats.entities > 0 ? "entity" : "scope") << ": " << count(Counter::Cycles) << " cycles, " << count(Counter::Instructions) << " instructions, " <<
+				count(Counter::L1DataMisses) << " L1 misses, " << count(Counter::LastLevelMisses) << " LLC misses, " << count(Counter::BranchMisses) << " branch misses\n";
+		}
 	}
 }
 
@@ -121,7 +157,7 @@ void testViewSorting()
 	}
 
 	auto view = em.getView<Position>();
-	view.for_each_entity([](Position& pos)
+	view.for_each_entity([](Position::SoARef pos)
 		{
 			pos.x = pos.x;
 		}
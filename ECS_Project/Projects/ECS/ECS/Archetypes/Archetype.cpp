@@ -0,0 +1,139 @@
+#include "pch_ECS.hpp"
+#include "Archetype.hpp"
+#include <algorithm>
+
+namespace ECS
+{
+	namespace
+	{
+		constexpr size_t CHUNK_ALIGNMENT = 64;
+
+		constexpr size_t alignUp(const size_t value, const size_t alignment) noexcept
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+	}
+
+	Archetype::Archetype(const Bitmask mask, const std::vector<const ComponentInfo*>& infos, std::pmr::memory_resource* resource) : m_resource(resource), m_mask(mask)
+	{
+		for (size_t typeID = 0; typeID < MAX_COMPONENT_TYPES; typeID++)
+		{
+			if (!mask.test(static_cast<ComponentTypeID>(typeID)))
+			{
+				continue;
+			}
+
+			if (typeID >= m_columnOfType.size())
+			{
+				m_columnOfType.resize(typeID + 1, NO_COLUMN);
+			}
+			m_columnOfType[typeID] = m_columns.size();
+			m_columns.push_back({ static_cast<ComponentTypeID>(typeID), infos[typeID], 0 });
+		}
+
+		// Fit as many rows as possible into a chunk, but always at least one
+		size_t rowSize = sizeof(EntityID);
+		for (const Column& column : m_columns)
+		{
+			rowSize += column.info->size;
+		}
+
+		m_chunkCapacity = (CHUNK_SIZE / rowSize > 0 ? CHUNK_SIZE / rowSize : 1);
+		while (m_chunkCapacity > 1 && calculateLayout(m_chunkCapacity) > CHUNK_SIZE)
+		{
+			m_chunkCapacity--;
+		}
+		m_chunkBytes = alignUp(std::max(calculateLayout(m_chunkCapacity), CHUNK_SIZE), CHUNK_ALIGNMENT);
+	}
+	Archetype::~Archetype()
+	{
+		for (size_t row = 0; row < m_size; row++)
+		{
+			for (size_t column = 0; column < m_columns.size(); column++)
+			{
+				m_columns[column].info->destroy(at(column, row));
+			}
+		}
+		while (!m_chunks.empty())
+		{
+			freeLastChunk();
+		}
+	}
+
+	[[nodiscard]] size_t Archetype::pushRow(const EntityID entityID)
+	{
+		if (m_size == m_chunks.size() * m_chunkCapacity)
+		{
+			allocateChunk();
+		}
+
+		const size_t row = m_size++;
+		reinterpret_cast<EntityID*>(m_chunks[row / m_chunkCapacity])[row % m_chunkCapacity] = entityID;
+		return row;
+	}
+	[[nodiscard]] EntityID Archetype::eraseRow(const size_t row, const Bitmask relocatedMask)
+	{
+		for (size_t column = 0; column < m_columns.size(); column++)
+		{
+			if (!relocatedMask.test(m_columns[column].typeID))
+			{
+				m_columns[column].info->destroy(at(column, row));
+			}
+		}
+
+		const size_t lastRow = m_size - 1;
+		EntityID movedEntityID = NO_ENTITY;
+
+		// Fill the hole with the last row
+		if (row != lastRow)
+		{
+			for (size_t column = 0; column < m_columns.size(); column++)
+			{
+				m_columns[column].info->relocate(at(column, row), at(column, lastRow));
+			}
+
+			movedEntityID = entities(lastRow / m_chunkCapacity)[lastRow % m_chunkCapacity];
+			reinterpret_cast<EntityID*>(m_chunks[row / m_chunkCapacity])[row % m_chunkCapacity] = movedEntityID;
+		}
+
+		m_size--;
+		if (m_size == (m_chunks.size() - 1) * m_chunkCapacity)
+		{
+			freeLastChunk();
+		}
+
+		return movedEntityID;
+	}
+
+	void Archetype::remapEntities(Span<const EntityID> newIDs)
+	{
+		for (size_t row = 0; row < m_size; row++)
+		{
+			EntityID& entityID = reinterpret_cast<EntityID*>(m_chunks[row / m_chunkCapacity])[row % m_chunkCapacity];
+			entityID = newIDs[static_cast<size_t>(entityID)];
+		}
+	}
+
+	size_t Archetype::calculateLayout(const size_t capacity)
+	{
+		// The entity column comes first, followed by each component column aligned to its type
+		size_t offset = sizeof(EntityID) * capacity;
+		for (Column& column : m_columns)
+		{
+			offset = alignUp(offset, column.info->alignment);
+			column.offset = offset;
+			offset += column.info->size * capacity;
+		}
+		return offset;
+	}
+	void Archetype::allocateChunk()
+	{
+		m_chunks.reserve(m_chunks.size() + 1);
+		m_chunks.push_back(static_cast<unsigned char*>(m_resource->allocate(m_chunkBytes, CHUNK_ALIGNMENT)));
+	}
+	void Archetype::freeLastChunk()
+	{
+		m_resource->deallocate(m_chunks.back(), m_chunkBytes, CHUNK_ALIGNMENT);
+		m_chunks.pop_back();
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <memory_resource>
+#include <vector>
+#include "Archetypes/ComponentInfo.hpp"
+#include "Components/Component.hpp"
+#include "Utilities/Span.hpp"
+
+namespace ECS
+{
+
+	/*
+		Storage for all entities sharing the exact same set of components.
+		Components are stored in fixed-size chunks, with one contiguous column per component type,
+		meaning that the n-th row of every column belongs to the same entity.
+		Removing a row moves the last row into the hole, keeping every chunk but the last one full.
+	*/
+	class Archetype final
+	{
+	public:
+		// Bytes per chunk, including the entity ID column
+		static constexpr size_t CHUNK_SIZE = 16 * 1024;
+		static constexpr size_t NO_COLUMN = static_cast<size_t>(-1);
+		static constexpr EntityID NO_ENTITY = -1;
+
+		// Chunks are allocated from the resource
+		Archetype(const Bitmask mask, const std::vector<const ComponentInfo*>& infos, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		Archetype(const Archetype& other) = delete;
+		~Archetype();
+		Archetype& operator=(const Archetype& other) = delete;
+
+		// Adds an uninitialized row for the entity and returns its index. Every column must be constructed by the caller
+		[[nodiscard]] size_t pushRow(const EntityID entityID);
+
+		// Removes a row. Columns of the types in relocatedMask are assumed to already have been moved out
+		// Returns the entity which was moved into the row, or NO_ENTITY if it was the last one
+		[[nodiscard]] EntityID eraseRow(const size_t row, const Bitmask relocatedMask = Bitmask());
+
+		// Replaces the ID of every row's entity with newIDs[ID], keeping the rows where they are
+		void remapEntities(Span<const EntityID> newIDs);
+
+		[[nodiscard]] bool matches(const Bitmask included, const Bitmask excluded) const noexcept
+		{
+			return m_mask.matches(included, excluded);
+		}
+
+		[[nodiscard]] size_t columnOf(const ComponentTypeID typeID) const noexcept
+		{
+			return (typeID < m_columnOfType.size() ? m_columnOfType[typeID] : NO_COLUMN);
+		}
+
+		// Pointer to the component of a column at a row
+		[[nodiscard]] void* at(const size_t column, const size_t row) const noexcept
+		{
+			return m_chunks[row / m_chunkCapacity] + m_columns[column].offset + (row % m_chunkCapacity) * m_columns[column].info->size;
+		}
+
+		// Pointer to the first component of a column within a chunk
+		template<typename CompType>
+		[[nodiscard]] CompType* column(const size_t chunk, const size_t column) const noexcept
+		{
+			return reinterpret_cast<CompType*>(m_chunks[chunk] + m_columns[column].offset);
+		}
+
+		[[nodiscard]] const EntityID* entities(const size_t chunk) const noexcept
+		{
+			return reinterpret_cast<const EntityID*>(m_chunks[chunk]);
+		}
+
+		// Number of rows in a chunk. Only the last chunk can be partially filled
+		[[nodiscard]] size_t chunkSize(const size_t chunk) const noexcept
+		{
+			return (chunk + 1 < m_chunks.size() ? m_chunkCapacity : m_size - chunk * m_chunkCapacity);
+		}
+
+		[[nodiscard]] Bitmask getMask() const noexcept { return m_mask; }
+		[[nodiscard]] size_t size() const noexcept { return m_size; }
+		[[nodiscard]] size_t chunkCount() const noexcept { return m_chunks.size(); }
+		[[nodiscard]] size_t chunkCapacity() const noexcept { return m_chunkCapacity; }
+		[[nodiscard]] size_t columnCount() const noexcept { return m_columns.size(); }
+		[[nodiscard]] ComponentTypeID typeOfColumn(const size_t column) const noexcept { return m_columns[column].typeID; }
+
+	private:
+		struct Column
+		{
+			ComponentTypeID typeID;
+			const ComponentInfo* info;
+			size_t offset;
+		};
+
+		size_t calculateLayout(const size_t capacity);
+		void allocateChunk();
+		void freeLastChunk();
+
+	private:
+		std::pmr::memory_resource* m_resource;
+		Bitmask m_mask;
+		size_t m_size = 0;
+		size_t m_chunkCapacity = 0;
+		size_t m_chunkBytes = CHUNK_SIZE;
+
+		std::vector<Column> m_columns;			// Sorted by type ID
+		std::vector<size_t> m_columnOfType;		// Type ID to column index
+		std::vector<unsigned char*> m_chunks;
+	};
+}
@@ -0,0 +1,121 @@
+#include "pch_ECS.hpp"
+#include "ArchetypeStorage.hpp"
+
+namespace ECS
+{
+	void ArchetypeStorage::remove(const EntityID entityID)
+	{
+		if (contains(entityID))
+		{
+			eraseFromArchetype(entityID, Bitmask());
+			m_locations[entityID] = Location();
+		}
+	}
+	void ArchetypeStorage::clear()
+	{
+		m_archetypes.clear();
+		m_archetypeOfMask.clear();
+		m_locations.clear();
+	}
+
+	void ArchetypeStorage::remapEntities(Span<const EntityID> newIDs)
+	{
+		std::pmr::vector<Location> locations(m_locations.get_allocator());
+		for (size_t oldID = 0; oldID < m_locations.size(); oldID++)
+		{
+			if (m_locations[oldID].archetype == NO_ARCHETYPE)
+			{
+				continue;
+			}
+
+			const size_t newID = static_cast<size_t>(newIDs[oldID]);
+			if (newID >= locations.size())
+			{
+				locations.resize(newID + 1);
+			}
+			locations[newID] = m_locations[oldID];
+		}
+		m_locations = std::move(locations);
+
+		for (const auto& archetype : m_archetypes)
+		{
+			archetype->remapEntities(newIDs);
+		}
+	}
+
+	bool ArchetypeStorage::contains(const EntityID entityID) const noexcept
+	{
+		return (entityID >= 0 && static_cast<size_t>(entityID) < m_locations.size() && m_locations[entityID].archetype != NO_ARCHETYPE);
+	}
+	Bitmask ArchetypeStorage::getMask(const EntityID entityID) const noexcept
+	{
+		return (contains(entityID) ? m_archetypes[m_locations[entityID].archetype]->getMask() : Bitmask());
+	}
+	size_t ArchetypeStorage::findOrCreateArchetype(const Bitmask mask)
+	{
+		const auto it = m_archetypeOfMask.find(mask);
+		if (it != m_archetypeOfMask.end())
+		{
+			return it->second;
+		}
+
+		const size_t index = m_archetypes.size();
+		m_archetypes.push_back(std::make_unique<Archetype>(mask, m_infos, m_resource));
+		m_archetypeOfMask.emplace(mask, index);
+		return index;
+	}
+
+	std::pair<Archetype*, size_t> ArchetypeStorage::moveEntity(const EntityID entityID, const Bitmask newMask)
+	{
+		if (static_cast<size_t>(entityID) >= m_locations.size())
+		{
+			m_locations.resize(static_cast<size_t>(entityID) + 1);
+		}
+
+		const bool hadArchetype = contains(entityID);
+		if (newMask.none())
+		{
+			if (hadArchetype)
+			{
+				eraseFromArchetype(entityID, Bitmask());
+			}
+			m_locations[entityID] = Location();
+			return { nullptr, 0 };
+		}
+
+		const size_t newArchetypeIndex = findOrCreateArchetype(newMask);
+		Archetype& newArchetype = *m_archetypes[newArchetypeIndex];
+		const size_t newRow = newArchetype.pushRow(entityID);
+
+		if (hadArchetype)
+		{
+			const Location oldLocation = m_locations[entityID];
+			const Archetype& oldArchetype = *m_archetypes[oldLocation.archetype];
+			const Bitmask sharedMask = oldArchetype.getMask() & newMask;
+
+			for (size_t column = 0; column < oldArchetype.columnCount(); column++)
+			{
+				const ComponentTypeID typeID = oldArchetype.typeOfColumn(column);
+				if (sharedMask.test(typeID))
+				{
+					m_infos[typeID]->relocate(newArchetype.at(newArchetype.columnOf(typeID), newRow), oldArchetype.at(column, oldLocation.row));
+				}
+			}
+
+			eraseFromArchetype(entityID, sharedMask);
+		}
+
+		m_locations[entityID] = { newArchetypeIndex, newRow };
+		return { &newArchetype, newRow };
+	}
+	void ArchetypeStorage::eraseFromArchetype(const EntityID entityID, const Bitmask relocatedMask)
+	{
+		const Location& location = m_locations[entityID];
+		const EntityID movedEntityID = m_archetypes[location.archetype]->eraseRow(location.row, relocatedMask);
+
+		if (movedEntityID != Archetype::NO_ENTITY)
+		{
+			m_locations[movedEntityID].row = location.row;
+		}
+	}
+}
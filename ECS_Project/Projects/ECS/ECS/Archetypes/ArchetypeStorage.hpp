@@ -0,0 +1,142 @@
+#pragma once
+#include <memory>
+#include <memory_resource>
+#include <unordered_map>
+#include "Archetypes/Archetype.hpp"
+#include "ECSTemplates.hpp"
+
+namespace ECS
+{
+	/*
+		Archetype based component storage.
+		Entities are grouped by their exact set of components, and every group is stored in chunks (see Archetype).
+		Attaching or detaching a component moves the entity's components to another archetype,
+		while iterating several component types is a linear walk through the matching chunks.
+	*/
+	class ArchetypeStorage final
+	{
+	public:
+		static constexpr size_t NO_ARCHETYPE = static_cast<size_t>(-1);
+
+		// Chunks and entity locations are allocated from the resource
+		explicit ArchetypeStorage(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : m_resource(resource), m_locations(resource) {}
+		ArchetypeStorage(const ArchetypeStorage& other) = delete;
+		~ArchetypeStorage() = default;
+		ArchetypeStorage& operator=(const ArchetypeStorage& other) = delete;
+
+		template<typename CompType, typename... Args>
+		CompType* attach(const EntityID entityID, Args&&... args)
+		{
+			static_assert(is_component<CompType>::value, "Not a component");
+			static_assert(!is_singleton<CompType>::value, "Singletons are not stored in archetypes");
+
+			registerType<CompType>();
+
+			const Bitmask oldMask = getMask(entityID);
+			if (oldMask.test(CompType::TYPE_ID))
+			{
+				return get<CompType>(entityID);
+			}
+
+			const auto [archetype, row] = moveEntity(entityID, oldMask | Bitmask::of(CompType::TYPE_ID));
+			void* address = archetype->at(archetype->columnOf(CompType::TYPE_ID), row);
+			return new (address) CompType(std::forward<Args>(args)...);
+		}
+
+		template<typename CompType>
+		void detach(const EntityID entityID)
+		{
+			static_assert(is_component<CompType>::value, "Not a component");
+
+			Bitmask mask = getMask(entityID);
+			if (mask.test(CompType::TYPE_ID))
+			{
+				mask.reset(CompType::TYPE_ID);
+				moveEntity(entityID, mask);
+			}
+		}
+
+		template<typename CompType>
+		[[nodiscard]] CompType* get(const EntityID entityID) const
+		{
+			static_assert(is_component<CompType>::value, "Not a component");
+
+			if (!contains(entityID))
+			{
+				return nullptr;
+			}
+
+			const Location& location = m_locations[entityID];
+			const Archetype& archetype = *m_archetypes[location.archetype];
+			const size_t column = archetype.columnOf(CompType::TYPE_ID);
+			return (column != Archetype::NO_COLUMN ? static_cast<CompType*>(archetype.at(column, location.row)) : nullptr);
+		}
+
+		// Number of stored components of a type
+		template<typename CompType>
+		[[nodiscard]] size_t count() const
+		{
+			static_assert(is_component<CompType>::value, "Not a component");
+
+			size_t total = 0;
+			for (const auto& archetype : m_archetypes)
+			{
+				if (archetype->getMask().test(CompType::TYPE_ID))
+				{
+					total += archetype->size();
+				}
+			}
+			return total;
+		}
+
+		// Destroys every component of an entity
+		void remove(const EntityID entityID);
+		void clear();
+
+		// Renumbers every stored entity to newIDs[ID]. Rows stay where they are, as chunks are already dense
+		void remapEntities(Span<const EntityID> newIDs);
+
+		[[nodiscard]] const std::vector<std::unique_ptr<Archetype>>& getArchetypes() const noexcept
+		{
+			return m_archetypes;
+		}
+
+	private:
+		struct Location
+		{
+			size_t archetype = NO_ARCHETYPE;
+			size_t row = 0;
+		};
+
+		template<typename CompType>
+		void registerType()
+		{
+			if (CompType::TYPE_ID >= m_infos.size())
+			{
+				m_infos.resize(CompType::TYPE_ID + 1, nullptr);
+			}
+			m_infos[CompType::TYPE_ID] = &getComponentInfo<CompType>();
+		}
+
+		bool contains(const EntityID entityID) const noexcept;
+		Bitmask getMask(const EntityID entityID) const noexcept;
+		size_t findOrCreateArchetype(const Bitmask mask);
+
+		// Relocates all components shared by the old and new archetype. Returns the new archetype and row
+		std::pair<Archetype*, size_t> moveEntity(const EntityID entityID, const Bitmask newMask);
+		void eraseFromArchetype(const EntityID entityID, const Bitmask relocatedMask);
+
+	private:
+		std::pmr::memory_resource* m_resource;
+
+		// Archetypes are never destroyed, meaning indices into this remain valid
+		std::vector<std::unique_ptr<Archetype>> m_archetypes;
+		std::unordered_map<Bitmask, size_t> m_archetypeOfMask;
+
+		// Archetype and row of each entity
+		std::pmr::vector<Location> m_locations;
+
+		// Type-erased info of each registered component type
+		std::vector<const ComponentInfo*> m_infos;
+	};
+}
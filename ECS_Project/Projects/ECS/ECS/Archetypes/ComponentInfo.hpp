@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+
+namespace ECS
+{
+	/*
+		Type-erased description of a component type.
+		Used by storages which keep components of several types in the same memory block.
+	*/
+	struct ComponentInfo final
+	{
+		size_t size;
+		size_t alignment;
+
+		// Move-constructs a component at dst from the one at src, then destroys the one at src
+		void (*relocate)(void* dst, void* src);
+
+		// Destroys the component at ptr
+		void (*destroy)(void* ptr);
+	};
+
+	template<typename CompType>
+	void relocateComponent(void* dst, void* src)
+	{
+		CompType* source = static_cast<CompType*>(src);
+		new (dst) CompType(std::move(*source));
+		source->~CompType();
+	}
+
+	template<typename CompType>
+	void destroyComponent(void* ptr)
+	{
+		static_cast<CompType*>(ptr)->~CompType();
+	}
+
+	// Retrieves the info of a component type. The returned reference is valid for the lifetime of the program
+	template<typename CompType>
+	const ComponentInfo& getComponentInfo() noexcept
+	{
+		static constexpr ComponentInfo s_info = { sizeof(CompType), alignof(CompType), &relocateComponent<CompType>, &destroyComponent<CompType> };
+		return s_info;
+	}
+}
@@ -0,0 +1,151 @@
+#include "pch_ECS.hpp"
+#include "CommandBuffer.hpp"
+
+namespace ECS
+{
+	Entity CommandBuffer::createEntity()
+	{
+		return Entity(NULL_ENTITY_ID - 1 - m_pendingEntityCount++, 0);
+	}
+	void CommandBuffer::destroyEntity(const Entity& entity)
+	{
+		m_destroyed.push_back(entity);
+	}
+
+	void CommandBuffer::playback(ECSManager& manager)
+	{
+		playback(manager, { this });
+	}
+
+	bool CommandBuffer::isEmpty() const noexcept
+	{
+		if (m_pendingEntityCount > 0 || !m_destroyed.empty())
+		{
+			return false;
+		}
+		return std::all_of(m_componentCommands.begin(), m_componentCommands.end(), [](const auto& commands) { return !commands || commands->isEmpty(); });
+	}
+
+	void CommandBuffer::createPendingEntities(ECSManager& manager)
+	{
+		m_createdEntities.clear();
+		m_createdEntities.reserve(static_cast<size_t>(m_pendingEntityCount));
+		for (EntityID i = 0; i < m_pendingEntityCount; i++)
+		{
+			m_createdEntities.push_back(manager.createEntity());
+		}
+		m_pendingEntityCount = 0;
+
+		for (auto& commands : m_componentCommands)
+		{
+			if (commands)
+			{
+				commands->resolve(m_createdEntities);
+			}
+		}
+		for (Entity& entity : m_destroyed)
+		{
+			entity = resolve(entity, m_createdEntities);
+		}
+	}
+
+	void CommandBuffer::playback(ECSManager& manager, const std::vector<CommandBuffer*>& buffers)
+	{
+		size_t typeCount = 0;
+		for (CommandBuffer* buffer : buffers)
+		{
+			buffer->createPendingEntities(manager);
+			typeCount = std::max(typeCount, buffer->m_componentCommands.size());
+		}
+
+		// Gather the commands of each type into the first buffer with any, and apply them all at once
+		for (size_t typeID = 0; typeID < typeCount; typeID++)
+		{
+			BaseComponentCommands* target = nullptr;
+			for (CommandBuffer* buffer : buffers)
+			{
+				if (typeID >= buffer->m_componentCommands.size() || !buffer->m_componentCommands[typeID] || buffer->m_componentCommands[typeID]->isEmpty())
+				{
+					continue;
+				}
+
+				BaseComponentCommands* commands = buffer->m_componentCommands[typeID].get();
+				if (target)
+				{
+					commands->appendTo(*target);
+				}
+				else
+				{
+					target = commands;
+				}
+			}
+
+			if (target)
+			{
+				target->playback(manager);
+			}
+		}
+
+		std::vector<Entity> destroyed;
+		for (CommandBuffer* buffer : buffers)
+		{
+			destroyed.insert(destroyed.end(), buffer->m_destroyed.begin(), buffer->m_destroyed.end());
+			buffer->m_destroyed.clear();
+		}
+
+		// Entities which are destroyed several times are only destroyed once, as their handles are invalid after the first time
+		std::sort(destroyed.begin(), destroyed.end(), [](const Entity& lhs, const Entity& rhs) { return lhs.ID < rhs.ID; });
+		manager.destroyEntities(Span<const Entity>(destroyed));
+	}
+
+
+	namespace
+	{
+		std::atomic<size_t> s_nextCommandBuffersID = 0;
+
+		// Buffer most recently used by the current thread, which avoids locking on every call to local()
+		struct LocalBufferCache
+		{
+			size_t instanceID = static_cast<size_t>(-1);
+			CommandBuffer* buffer = nullptr;
+		};
+		thread_local LocalBufferCache t_localBuffer;
+	}
+
+	CommandBuffers::CommandBuffers() : m_instanceID(s_nextCommandBuffersID.fetch_add(1, std::memory_order_relaxed))
+	{
+	}
+
+	CommandBuffer& CommandBuffers::local()
+	{
+		if (t_localBuffer.instanceID == m_instanceID)
+		{
+			return *t_localBuffer.buffer;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::unique_ptr<CommandBuffer>& buffer = m_buffers[std::this_thread::get_id()];
+		if (!buffer)
+		{
+			buffer = std::make_unique<CommandBuffer>();
+		}
+
+		t_localBuffer = { m_instanceID, buffer.get() };
+		return *buffer;
+	}
+
+	void CommandBuffers::playback(ECSManager& manager)
+	{
+		std::vector<CommandBuffer*> buffers;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			buffers.reserve(m_buffers.size());
+			for (auto& [thread, buffer] : m_buffers)
+			{
+				buffers.push_back(buffer.get());
+			}
+		}
+
+		CommandBuffer::playback(manager, buffers);
+	}
+}
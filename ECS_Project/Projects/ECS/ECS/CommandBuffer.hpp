@@ -0,0 +1,280 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ECSManager.hpp"
+
+namespace ECS
+{
+	/*
+		Queued component changes of one type, which are applied as one batch per type.
+	*/
+	class BaseComponentCommands
+	{
+	public:
+		virtual ~BaseComponentCommands() = default;
+
+		// Replaces handles of entities created by the buffer with the handles of the created entities
+		virtual void resolve(const std::vector<Entity>& createdEntities) = 0;
+
+		// Moves every queued change into other, which must be of the same type
+		virtual void appendTo(BaseComponentCommands& other) = 0;
+
+		virtual void playback(ECSManager& manager) = 0;
+
+		[[nodiscard]] virtual bool isEmpty() const noexcept = 0;
+	};
+
+	template<typename CompType>
+	class ComponentCommands final : public BaseComponentCommands
+	{
+	public:
+		template<typename... Args>
+		void attach(const Entity& entity, Args&&... args)
+		{
+			m_components.emplace_back(std::forward<Args>(args)...);
+			m_commands.push_back({ entity, m_components.size() - 1 });
+		}
+		void detach(const Entity& entity)
+		{
+			m_commands.push_back({ entity, DETACH });
+		}
+
+		void resolve(const std::vector<Entity>& createdEntities) override;
+
+		void appendTo(BaseComponentCommands& other) override
+		{
+			ComponentCommands& target = static_cast<ComponentCommands&>(other);
+			const size_t offset = target.m_components.size();
+			for (const Command& command : m_commands)
+			{
+				target.m_commands.push_back({ command.entity, (command.component == DETACH ? DETACH : command.component + offset) });
+			}
+			std::move(m_components.begin(), m_components.end(), std::back_inserter(target.m_components));
+			m_commands.clear();
+			m_components.clear();
+		}
+
+		void playback(ECSManager& manager) override
+		{
+			// Sorting by entity walks the sparse pages of the pool in order, and appends to the dense array in order
+			// The sort is stable, which keeps the commands of each entity in the order they were recorded
+			std::stable_sort(m_commands.begin(), m_commands.end(), [](const Command& lhs, const Command& rhs)
+				{
+					return (lhs.entity.ID != rhs.entity.ID ? lhs.entity.ID < rhs.entity.ID : lhs.entity.generation < rhs.entity.generation);
+				}
+			);
+
+			// The commands of each entity are reduced to what applying them in order does, which is at most a detachment followed by an attachment
+			// An attachment only has an effect if the entity lacks the component, meaning that the first one after the last detachment is the one kept
+			std::vector<Entity> detached;
+			std::vector<Entity> attached;
+			std::vector<CompType> components;
+			for (size_t first = 0; first < m_commands.size();)
+			{
+				const Entity entity = m_commands[first].entity;
+				bool isDetached = false;
+				size_t component = DETACH;
+				size_t last = first;
+				for (; last < m_commands.size() && m_commands[last].entity == entity; last++)
+				{
+					if (m_commands[last].component == DETACH)
+					{
+						isDetached = true;
+						component = DETACH;
+					}
+					else if (component == DETACH)
+					{
+						component = m_commands[last].component;
+					}
+				}
+
+				if (isDetached)
+				{
+					detached.push_back(entity);
+				}
+				if (component != DETACH)
+				{
+					attached.push_back(entity);
+					components.push_back(std::move(m_components[component]));
+				}
+				first = last;
+			}
+
+			for (const Entity& entity : detached)
+			{
+				manager.detachComponent<CompType>(entity);
+			}
+
+			if constexpr (is_singleton<CompType>::value || !std::is_copy_constructible_v<CompType>)
+			{
+				for (size_t i = 0; i < attached.size(); i++)
+				{
+					manager.attachComponent<CompType>(attached[i], std::move(components[i]));
+				}
+			}
+			else
+			{
+				manager.attachComponents<CompType>(Span<const Entity>(attached), Span<const CompType>(components));
+			}
+
+			m_commands.clear();
+			m_components.clear();
+		}
+
+		[[nodiscard]] bool isEmpty() const noexcept override
+		{
+			return m_commands.empty();
+		}
+
+	private:
+		// Component index of a detachment
+		static constexpr size_t DETACH = static_cast<size_t>(-1);
+
+		struct Command
+		{
+			Entity entity;
+			// Index of the attached component, or DETACH
+			size_t component;
+		};
+
+		std::vector<Command> m_commands;
+		std::vector<CompType> m_components;
+	};
+
+
+	/*
+		Records entity creation and destruction, and component attachment and detachment, to be applied later.
+
+		Changing which components exist while iterating a view moves components under the loop,
+		so changes made during iteration are recorded here and played back once the iteration is done.
+		Playback applies every creation first, then the attachments and detachments of one component type at a time,
+		sorted by entity, and lastly every destruction. The attachments and detachments of an entity and a type end up
+		as if they were applied in the order they were recorded, but not in order with those of other types or with destruction.
+
+		Entities created by the buffer don't exist until playback, but the returned handles can be used in later commands of the same buffer.
+		A buffer must only be used by one thread at a time, see CommandBuffers for recording from several threads.
+	*/
+	class CommandBuffer final
+	{
+	public:
+		CommandBuffer() = default;
+		CommandBuffer(const CommandBuffer& other) = delete;
+		~CommandBuffer() = default;
+		CommandBuffer& operator=(const CommandBuffer& other) = delete;
+
+		// Returns a handle which is only meaningful to this buffer until playback
+		[[nodiscard]] Entity createEntity();
+		void destroyEntity(const Entity& entity);
+
+		template<typename CompType, typename... Args>
+		void attachComponent(const Entity& entity, Args&&... args)
+		{
+			static_assert(is_component<CompType>::value, "Not a component");
+			commandsOf<CompType>().attach(entity, std::forward<Args>(args)...);
+		}
+		template<typename CompType>
+		void detachComponent(const Entity& entity)
+		{
+			static_assert(is_component<CompType>::value, "Not a component");
+			commandsOf<CompType>().detach(entity);
+		}
+
+		// Applies and clears every recorded command
+		void playback(ECSManager& manager);
+
+		[[nodiscard]] bool isEmpty() const noexcept;
+
+		// Handles of created entities have IDs below NULL_ENTITY_ID, counting down from the first created one
+		[[nodiscard]] static bool isPending(const Entity& entity) noexcept
+		{
+			return (entity.ID < NULL_ENTITY_ID);
+		}
+
+	private:
+		friend class CommandBuffers;
+		template<typename CompType>
+		friend class ComponentCommands;
+
+		template<typename CompType>
+		ComponentCommands<CompType>& commandsOf()
+		{
+			static constexpr size_t compTypeID = static_cast<size_t>(CompType::TYPE_ID);
+			if (compTypeID >= m_componentCommands.size())
+			{
+				m_componentCommands.resize(compTypeID + 1);
+			}
+
+			std::unique_ptr<BaseComponentCommands>& commands = m_componentCommands[compTypeID];
+			if (!commands)
+			{
+				commands = std::make_unique<ComponentCommands<CompType>>();
+			}
+			return static_cast<ComponentCommands<CompType>&>(*commands);
+		}
+
+		// Creates the pending entities and replaces their handles in every command
+		void createPendingEntities(ECSManager& manager);
+
+		// Plays back the commands of several buffers as one, merging the commands of each component type
+		static void playback(ECSManager& manager, const std::vector<CommandBuffer*>& buffers);
+
+		// Handle of the created entity if the passed handle is pending, otherwise the passed handle
+		static Entity resolve(const Entity& entity, const std::vector<Entity>& createdEntities) noexcept
+		{
+			return (isPending(entity) ? createdEntities[static_cast<size_t>(NULL_ENTITY_ID - 1 - entity.ID)] : entity);
+		}
+
+	private:
+		EntityID m_pendingEntityCount = 0;
+		std::vector<Entity> m_destroyed;
+
+		// Queued changes of each component type, indexed by type ID
+		std::vector<std::unique_ptr<BaseComponentCommands>> m_componentCommands;
+
+		// Entities created during the current playback, indexed by their pending position
+		std::vector<Entity> m_createdEntities;
+	};
+
+	template<typename CompType>
+	void ComponentCommands<CompType>::resolve(const std::vector<Entity>& createdEntities)
+	{
+		for (Command& command : m_commands)
+		{
+			command.entity = CommandBuffer::resolve(command.entity, createdEntities);
+		}
+	}
+
+
+	/*
+		One command buffer per thread, which lets commands be recorded from parallel iteration without locking per command.
+		Every buffer is played back together, as if all commands were recorded into one buffer.
+	*/
+	class CommandBuffers final
+	{
+	public:
+		CommandBuffers();
+		CommandBuffers(const CommandBuffers& other) = delete;
+		~CommandBuffers() = default;
+		CommandBuffers& operator=(const CommandBuffers& other) = delete;
+
+		// Buffer of the calling thread
+		CommandBuffer& local();
+
+		// Applies and clears the commands of every thread. Must not be called while other threads record commands
+		void playback(ECSManager& manager);
+
+	private:
+		// Identifies this object in the per-thread cache, as addresses can be reused
+		const size_t m_instanceID;
+
+		std::mutex m_mutex;
+		std::unordered_map<std::thread::id, std::unique_ptr<CommandBuffer>> m_buffers;
+	};
+}
@@ -1,8 +1,9 @@
 #pragma once
+#include "ComponentMask.hpp"
+#include "Utilities/SoA.hpp"
 
 namespace ECS
 {
-	using ComponentTypeID = unsigned char;
 	using EntityID = int;
 
 	/*
@@ -18,6 +19,8 @@ namespace ECS
 	template<ComponentTypeID ID>
 	struct Component
 	{
+		static_assert(ID < MAX_COMPONENT_TYPES, "Type ID doesn't fit in a component mask, increase ECS_MASK_BITS");
+
 		static constexpr ComponentTypeID TYPE_ID = ID;
 		//EntityID entityID;
 	};
@@ -25,4 +28,6 @@ namespace ECS
 }
 
 // Used as a singleton component tag
-#define MAKE_SINGLETON static constexpr bool IS_SINGLETON = true
\ No newline at end of file
+#define MAKE_SINGLETON static constexpr bool IS_SINGLETON = true
+
+// Components can be stored as structure-of-arrays with MAKE_SOA(Type, fields...), see Utilities/SoA.hpp
\ No newline at end of file
@@ -0,0 +1,117 @@
+#pragma once
+#include "ComponentPool.hpp"
+#include "Utilities/HelperTemplates.hpp"
+#include "ECSTemplates.hpp"
+
+namespace ECS
+{
+	using EntityID = int;
+
+	/*
+		A group owns the pools of several component types and keeps them ordered the same way:
+		the entities with every owned component are stored in the first size() slots of each pool, in the same order.
+		Iterating a group is therefore a lockstep walk through the pools, without any lookups.
+
+		The group must be told about every attach and detach of its owned types, which is done by the ECSManager.
+	*/
+	class BaseComponentGroup
+	{
+	public:
+		BaseComponentGroup(const BaseComponentGroup& other) = delete;
+		virtual ~BaseComponentGroup() = default;
+		BaseComponentGroup& operator=(const BaseComponentGroup& other) = delete;
+
+		// Must be called after a component of an owned type was attached
+		virtual void onAttach(const EntityID entityID) = 0;
+
+		// Must be called before a component of an owned type is detached
+		virtual void onDetach(const EntityID entityID) = 0;
+
+		[[nodiscard]] size_t size() const noexcept
+		{
+			return m_size;
+		}
+		[[nodiscard]] Bitmask getMask() const noexcept
+		{
+			return m_mask;
+		}
+
+	protected:
+		BaseComponentGroup(const Bitmask mask) : m_mask(mask) {}
+
+	protected:
+		// Number of entities with every owned component
+		size_t m_size = 0;
+
+		// Owned component types
+		const Bitmask m_mask;
+	};
+
+	template<typename... OwnedTypes>
+	class ComponentGroup final : public BaseComponentGroup
+	{
+		static_assert(sizeof...(OwnedTypes) > 1, "A group needs at least two types");
+		static_assert(!(is_singleton<OwnedTypes>::value || ...), "Singletons can't be grouped");
+
+		using FirstType = typename int_to_type<0, OwnedTypes...>::type;
+
+	public:
+		// Takes ownership of the pools and groups all entities which already have every owned component
+		ComponentGroup(ComponentPool<OwnedTypes>*... pools) : BaseComponentGroup((ComponentMask::of(OwnedTypes::TYPE_ID) | ...)), m_pools{ pools... }
+		{
+			((pools->group = this), ...);
+
+			const auto& elemToIndex = getPool<FirstType>().components.getElemToIndex();
+			for (size_t i = 0; i < elemToIndex.size(); i++)
+			{
+				onAttach(elemToIndex[i]);
+			}
+		}
+		~ComponentGroup()
+		{
+			((std::get<ComponentPool<OwnedTypes>*>(m_pools)->group = nullptr), ...);
+		}
+
+		void onAttach(const EntityID entityID) override
+		{
+			const bool hasAll = (getPool<OwnedTypes>().components.has(entityID) && ...);
+			if (hasAll && !isGrouped(entityID))
+			{
+				(moveTo<OwnedTypes>(entityID, m_size), ...);
+				m_size++;
+			}
+		}
+		void onDetach(const EntityID entityID) override
+		{
+			if (isGrouped(entityID))
+			{
+				m_size--;
+				(moveTo<OwnedTypes>(entityID, m_size), ...);
+			}
+		}
+
+	private:
+		template<typename CompType>
+		ComponentPool<CompType>& getPool()
+		{
+			return *std::get<ComponentPool<CompType>*>(m_pools);
+		}
+
+		bool isGrouped(const EntityID entityID)
+		{
+			const auto denseIndex = getPool<FirstType>().components.denseIndexOf(entityID);
+			return (denseIndex != -1 && static_cast<size_t>(denseIndex) < m_size);
+		}
+
+		// Moves an entity's component to a dense position, and the component at that position to where it was
+		template<typename CompType>
+		void moveTo(const EntityID entityID, const size_t denseIndex)
+		{
+			auto& components = getPool<CompType>().components;
+			components.swapDense(components.denseIndexOf(entityID), static_cast<EntityID>(denseIndex));
+		}
+
+	private:
+		const std::tuple<ComponentPool<OwnedTypes>*...> m_pools;
+	};
+}
@@ -0,0 +1,273 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define ECS_MASK_AVX
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#define ECS_MASK_SSE4
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ECS_MASK_SSE2
+#endif
+
+// Number of component types which fit in a mask, which limits the highest type ID. Must be a multiple of 64
+// Define it before including any ECS header, or for the whole project, to change it
+#ifndef ECS_MASK_BITS
+#define ECS_MASK_BITS 128
+#endif
+
+namespace ECS
+{
+	using ComponentTypeID = std::uint16_t;
+
+	static constexpr size_t MAX_COMPONENT_TYPES = ECS_MASK_BITS;
+
+	/*
+		Fixed width set of component types, with one bit per type ID.
+
+		The words are aligned to let the include and exclude tests load them with as few vector instructions as possible.
+		Tests use AVX when compiled with it, otherwise SSE, with a scalar fallback for other targets.
+		Widths which aren't a multiple of 256 bits test with SSE, and those which aren't a multiple of 128 bits with the scalar fallback.
+		Everything except the tests is constexpr, which lets masks of type lists be computed at compile time.
+	*/
+	class ComponentMask final
+	{
+	public:
+		static_assert(ECS_MASK_BITS > 0 && ECS_MASK_BITS % 64 == 0, "ECS_MASK_BITS must be a positive multiple of 64");
+
+		static constexpr size_t WORD_COUNT = ECS_MASK_BITS / 64;
+		// Largest power of two which divides the size, so that every mask in an array is aligned as well
+		static constexpr size_t ALIGNMENT = (WORD_COUNT % 4 == 0 ? 32 : (WORD_COUNT % 2 == 0 ? 16 : 8));
+
+		constexpr ComponentMask() noexcept = default;
+
+		// Mask of a single type
+		[[nodiscard]] static constexpr ComponentMask of(const ComponentTypeID typeID) noexcept
+		{
+			ComponentMask mask;
+			mask.set(typeID);
+			return mask;
+		}
+
+		constexpr void set(const ComponentTypeID typeID) noexcept
+		{
+			m_words[typeID / 64] |= (1ULL << (typeID % 64));
+		}
+		constexpr void reset(const ComponentTypeID typeID) noexcept
+		{
+			m_words[typeID / 64] &= ~(1ULL << (typeID % 64));
+		}
+		[[nodiscard]] constexpr bool test(const ComponentTypeID typeID) const noexcept
+		{
+			return (m_words[typeID / 64] & (1ULL << (typeID % 64))) != 0;
+		}
+
+		[[nodiscard]] constexpr bool none() const noexcept
+		{
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				if (m_words[i] != 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		[[nodiscard]] constexpr bool any() const noexcept
+		{
+			return !none();
+		}
+		[[nodiscard]] constexpr bool intersects(const ComponentMask& other) const noexcept
+		{
+			return (*this & other).any();
+		}
+
+		// True if every type of included is in this mask, and no type of excluded is
+		[[nodiscard]] bool matches(const ComponentMask& included, const ComponentMask& excluded) const noexcept
+		{
+#if defined(ECS_MASK_AVX)
+			if constexpr (WORD_COUNT % 4 == 0)
+			{
+				int result = 1;
+				for (size_t i = 0; i < WORD_COUNT; i += 4)
+				{
+					const __m256i words = load256(m_words + i);
+					result &= _mm256_testc_si256(words, load256(included.m_words + i)) & _mm256_testz_si256(words, load256(excluded.m_words + i));
+				}
+				return result != 0;
+			}
+#endif
+#if defined(ECS_MASK_AVX) || defined(ECS_MASK_SSE4)
+			if constexpr (WORD_COUNT % 2 == 0)
+			{
+				int result = 1;
+				for (size_t i = 0; i < WORD_COUNT; i += 2)
+				{
+					const __m128i words = load128(m_words + i);
+					result &= _mm_testc_si128(words, load128(included.m_words + i)) & _mm_testz_si128(words, load128(excluded.m_words + i));
+				}
+				return result != 0;
+			}
+#elif defined(ECS_MASK_SSE2)
+			if constexpr (WORD_COUNT % 2 == 0)
+			{
+				// Every byte of (words & included) must equal included, and every byte of (words & excluded) must be zero
+				int result = 0xFFFF;
+				for (size_t i = 0; i < WORD_COUNT; i += 2)
+				{
+					const __m128i words = load128(m_words + i);
+					const __m128i includedWords = load128(included.m_words + i);
+					const __m128i hasIncluded = _mm_cmpeq_epi8(_mm_and_si128(words, includedWords), includedWords);
+					const __m128i hasNoExcluded = _mm_cmpeq_epi8(_mm_and_si128(words, load128(excluded.m_words + i)), _mm_setzero_si128());
+					result &= _mm_movemask_epi8(_mm_and_si128(hasIncluded, hasNoExcluded));
+				}
+				return result == 0xFFFF;
+			}
+#endif
+			std::uint64_t mismatch = 0;
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				mismatch |= (~m_words[i] & included.m_words[i]) | (m_words[i] & excluded.m_words[i]);
+			}
+			return mismatch == 0;
+		}
+		[[nodiscard]] bool containsAll(const ComponentMask& included) const noexcept
+		{
+			return matches(included, ComponentMask());
+		}
+
+		constexpr ComponentMask& operator|=(const ComponentMask& other) noexcept
+		{
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				m_words[i] |= other.m_words[i];
+			}
+			return *this;
+		}
+		constexpr ComponentMask& operator&=(const ComponentMask& other) noexcept
+		{
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				m_words[i] &= other.m_words[i];
+			}
+			return *this;
+		}
+		[[nodiscard]] constexpr ComponentMask operator|(const ComponentMask& other) const noexcept
+		{
+			ComponentMask result = *this;
+			return (result |= other);
+		}
+		[[nodiscard]] constexpr ComponentMask operator&(const ComponentMask& other) const noexcept
+		{
+			ComponentMask result = *this;
+			return (result &= other);
+		}
+		[[nodiscard]] constexpr ComponentMask operator~() const noexcept
+		{
+			ComponentMask result;
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				result.m_words[i] = ~m_words[i];
+			}
+			return result;
+		}
+
+		[[nodiscard]] constexpr bool operator==(const ComponentMask& other) const noexcept
+		{
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				if (m_words[i] != other.m_words[i])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		[[nodiscard]] constexpr bool operator!=(const ComponentMask& other) const noexcept
+		{
+			return !(*this == other);
+		}
+
+		[[nodiscard]] constexpr std::uint64_t word(const size_t index) const noexcept
+		{
+			return m_words[index];
+		}
+
+		// Calls func(typeID) for every type in the mask, in ascending order, skipping unset bits a word at a time
+		template<typename Func>
+		void forEachType(Func func) const
+		{
+			for (size_t i = 0; i < WORD_COUNT; i++)
+			{
+				for (std::uint64_t word = m_words[i]; word != 0; word &= word - 1)
+				{
+					func(static_cast<ComponentTypeID>(i * 64 + lowestSetBit(word)));
+				}
+			}
+		}
+
+	private:
+		// Index of the lowest set bit of a non-zero word
+		static unsigned lowestSetBit(const std::uint64_t word) noexcept
+		{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+			unsigned long index = 0;
+			_BitScanForward64(&index, word);
+			return static_cast<unsigned>(index);
+#elif defined(__GNUC__)
+			return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+			unsigned index = 0;
+			while ((word & (1ULL << index)) == 0)
+			{
+				index++;
+			}
+			return index;
+#endif
+		}
+
+#if defined(ECS_MASK_AVX)
+		static __m256i load256(const std::uint64_t* words) noexcept
+		{
+			return _mm256_load_si256(reinterpret_cast<const __m256i*>(words));
+		}
+#endif
+#if defined(ECS_MASK_AVX) || defined(ECS_MASK_SSE4) || defined(ECS_MASK_SSE2)
+		static __m128i load128(const std::uint64_t* words) noexcept
+		{
+			return _mm_load_si128(reinterpret_cast<const __m128i*>(words));
+		}
+#endif
+
+	private:
+		alignas(ALIGNMENT) std::uint64_t m_words[WORD_COUNT] = {};
+	};
+
+	// Used to keep track of components of an entity
+	using Bitmask = ComponentMask;
+}
+
+namespace std
+{
+	template<>
+	struct hash<ECS::ComponentMask>
+	{
+		size_t operator()(const ECS::ComponentMask& mask) const noexcept
+		{
+			std::uint64_t result = 0;
+			for (size_t i = 0; i < ECS::ComponentMask::WORD_COUNT; i++)
+			{
+				result = (result ^ mask.word(i)) * 0x100000001B3ULL;
+			}
+			return static_cast<size_t>(result ^ (result >> 32));
+		}
+	};
+}
@@ -1,27 +1,193 @@
 #pragma once
+#include <memory_resource>
+#include <new>
 #include "Utilities/SparseSet.hpp"
+#include "Utilities/Span.hpp"
+#include "Utilities/Serialization/BinaryWriter.hpp"
+#include "Component.hpp"
+#include "ECSTemplates.hpp"
 
 namespace ECS
 {
+	class BaseComponentGroup;
+
+	// Counter which changes to components are stamped with, see ECSManager::advanceTick
+	using Tick = std::uint32_t;
+
 	class BaseComponentPool
 	{
 	public:
 		BaseComponentPool(const BaseComponentPool& other) = delete;
 		virtual ~BaseComponentPool() = default;
 		BaseComponentPool& operator=(const BaseComponentPool& other) = delete;
+
+		// Destroys the pool and returns its memory to the resource it was created from
+		virtual void destroy() noexcept = 0;
+
+		// Renumbers the entities of every component, see SparseSet::remap
+		virtual void remapEntities(Span<const EntityID> newIDs) = 0;
+
+		// Orders the components by entity ID, see SparseSet::sort
+		virtual void sortByEntity() = 0;
+
+		// Removes the components of entities which are all known to have one, as one batch. A group must be told about them first
+		virtual void removeMany(Span<const EntityID> entityIDs) = 0;
+		// Removes every component. A group must be cleared first
+		virtual void clear() = 0;
+
+		// True if the component type is trivially copyable or has serialization hooks, see Serialization::is_serializable
+		virtual bool canSave() const noexcept = 0;
+		// Writes every component, see SparseSet::save. Returns false if the type can't be saved or the writer failed
+		virtual bool save(Serialization::BinaryWriter& writer) const = 0;
+		// Writes the components changed after the tick, see SparseSet::saveChanges
+		virtual bool saveChanges(Serialization::BinaryWriter& writer, const Tick since) const = 0;
+
+		// Starts stamping components with ticks read from the clock, see SparseSet::trackTicks
+		virtual void trackTicks(const Tick* clock) = 0;
+
+	public:
+		// Group which owns this pool and decides the order of its components, if any
+		BaseComponentGroup* group = nullptr;
+
+		// Size and alignment of the component type, which snapshots record to detect changed layouts
+		const size_t componentSize;
+		const size_t componentAlignment;
+
 	protected:
-		BaseComponentPool() = default;
+		BaseComponentPool(std::pmr::memory_resource* resource, const size_t size, const size_t alignment) :
+			componentSize(size), componentAlignment(alignment), m_resource(resource) {}
+
+	protected:
+		// Resource which the pool and its components are allocated from
+		std::pmr::memory_resource* m_resource;
 	};
 
+	// Pointer to a component, which is a SoAPointer for types stored as structure-of-arrays
+	template<typename T>
+	using ComponentPointer = typename SparseSet<T>::Pointer;
+
+	// Pool of a non-singleton component type. Singletons are kept by the ECSManager, see ECSManager::getSingleton
 	template<typename T>
 	class ComponentPool final : public BaseComponentPool
 	{
+		static_assert(!is_singleton<T>::value, "Singletons aren't stored in pools");
+
 	public:
-		ComponentPool() = default;
+		// T* for regular components, and SoAPointer<T> for components stored as structure-of-arrays
+		using Pointer = ComponentPointer<T>;
+
+		// T* for regular components, and T::SoASpan for components stored as structure-of-arrays
+		using DenseBase = typename soa_dense_base<T>::type;
+
+		explicit ComponentPool(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : BaseComponentPool(resource, sizeof(T), alignof(T)), components(resource)
+		{
+		}
 		ComponentPool(const ComponentPool& other) = delete;
 		~ComponentPool() = default;
 		ComponentPool& operator=(const ComponentPool& other) = delete;
 
+		// Creates a pool which is itself allocated from the resource, and must be released with destroy()
+		static ComponentPool* create(std::pmr::memory_resource* resource)
+		{
+			std::pmr::polymorphic_allocator<ComponentPool> allocator(resource);
+			ComponentPool* pool = allocator.allocate(1);
+			try
+			{
+				return new (pool) ComponentPool(resource);
+			}
+			catch (...)
+			{
+				allocator.deallocate(pool, 1);
+				throw;
+			}
+		}
+		void destroy() noexcept override
+		{
+			std::pmr::polymorphic_allocator<ComponentPool> allocator(m_resource);
+			this->~ComponentPool();
+			allocator.deallocate(this, 1);
+		}
+
+		void removeMany(Span<const EntityID> entityIDs) override
+		{
+			for (const EntityID entityID : entityIDs)
+			{
+				components.remove(entityID);
+			}
+		}
+		void remapEntities(Span<const EntityID> newIDs) override
+		{
+			components.remap(newIDs);
+		}
+		void sortByEntity() override
+		{
+			components.sort();
+		}
+		void clear() override
+		{
+			components.clear();
+		}
+
+		bool canSave() const noexcept override
+		{
+			return SparseSet<T>::IS_SERIALIZABLE;
+		}
+		bool save(Serialization::BinaryWriter& writer) const override
+		{
+			if constexpr (SparseSet<T>::IS_SERIALIZABLE)
+			{
+				components.save(writer);
+				return writer.isGood();
+			}
+			else
+			{
+				return false;
+			}
+		}
+		bool saveChanges(Serialization::BinaryWriter& writer, const Tick since) const override
+		{
+			if constexpr (SparseSet<T>::IS_SERIALIZABLE)
+			{
+				components.saveChanges(writer, since);
+				return writer.isGood();
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		void trackTicks(const Tick* clock) override
+		{
+			components.trackTicks(clock);
+		}
+
+		// Start of the dense components, which can be indexed to reach a component by its dense position
+		DenseBase getDenseBase()
+		{
+			if constexpr (SparseSet<T>::IS_SOA)
+			{
+				return components.getElements().spans();
+			}
+			else
+			{
+				return components.getElements().data();
+			}
+		}
+
+		// Converts a pointer to a component stored elsewhere, such as in an archetype, to this pool's pointer type
+		static Pointer pointerTo(T* component)
+		{
+			if constexpr (SparseSet<T>::IS_SOA)
+			{
+				return (component ? Pointer(SoAColumns<T>::refOf(*component)) : Pointer());
+			}
+			else
+			{
+				return component;
+			}
+		}
+
 	public:
 		SparseSet<T> components;
 	};
@@ -1,92 +1,295 @@
 #pragma once
+#include "Entity.h"
 #include "ComponentPool.hpp"
+#include "ComponentGroup.hpp"
+#include "Archetypes/ArchetypeStorage.hpp"
 #include "Utilities/HelperTemplates.hpp"
+#include "Utilities/PerfCounters.hpp"
+#include "Utilities/Threading/ThreadPool.hpp"
 #include "ECSTemplates.hpp"
 
 namespace ECS
 {
 	using EntityID = int;
-	using Bitmask = size_t;
 
 	template<typename... T>
 	static constexpr Bitmask calculateMask()
 	{
 		if constexpr (sizeof...(T) == 0)
 		{
-			return 0;
+			return ComponentMask();
 		}
 		else
 		{
-			return ((1 << T::TYPE_ID) | ...);
+			return (ComponentMask::of(T::TYPE_ID) | ...);
 		}
 	}
 
+	// Function which is sent the entity ID before the components when iterating a view, see withEntityID
+	template<typename Function>
+	struct WithEntityID
+	{
+		Function function;
+	};
+
+	// Lets a function passed to for_each_entity or for_each_entity_parallel receive the ID of each entity as its first argument
+	template<typename Function>
+	WithEntityID<Function> withEntityID(Function function)
+	{
+		return { std::move(function) };
+	}
+
+	// Function which counts the entities it's called on, which views wrap around functions while Timer counters are enabled
+	template<typename Function>
+	struct CountedFunction
+	{
+		Function& function;
+		std::uint64_t count;
+	};
+
+	// Function called by a view, and the position of its first component parameter
+	template<typename Function>
+	struct unwrapped_function
+	{
+		using type = Function;
+		static constexpr size_t FIRST_COMPONENT = 0;
+	};
+	template<typename Function>
+	struct unwrapped_function<WithEntityID<Function>>
+	{
+		using type = Function;
+		static constexpr size_t FIRST_COMPONENT = 1;
+	};
+	template<typename Function>
+	struct unwrapped_function<CountedFunction<Function>> : public unwrapped_function<Function> {};
+
+	// Filters of a view, which only let through entities whose component of the type was changed or added after a tick
+	// Additions count as changes. Pass the tick returned by ECSManager::advanceTick after the previous iteration
+	template<typename CompType>
+	struct Changed
+	{
+		Tick since = 0;
+	};
+	template<typename CompType>
+	struct Added
+	{
+		Tick since = 0;
+	};
+
+	// Default evaluates to false
+	template<typename T>
+	struct is_view_filter : public std::false_type {};
+
+	// Evaluates to true if type T is Changed or Added
+	template<typename CompType>
+	struct is_view_filter<Changed<CompType>> : public std::true_type {};
+	template<typename CompType>
+	struct is_view_filter<Added<CompType>> : public std::true_type {};
+
+	// Component type of a filter
+	template<typename Filter>
+	struct filtered_type;
+	template<typename CompType>
+	struct filtered_type<Changed<CompType>> { using type = CompType; };
+	template<typename CompType>
+	struct filtered_type<Added<CompType>> { using type = CompType; };
+
+	// What a view reads an included type from, which is the singleton itself for singletons, and the pool for other types
+	template<typename CompType>
+	using included_storage_t = std::conditional_t<is_singleton<CompType>::value, CompType, ComponentPool<CompType>>;
+
+	// How a view finds the entities to iterate, when not using archetypes
+	enum class IterationStrategy
+	{
+		Automatic,		// Scans masks when that's estimated to need fewer lookups than driving from the smallest pool
+		DrivenByPool,	// Walks the smallest included pool and probes the others, or walks a group or a single pool directly
+		MaskScan		// Tests the component mask of every entity and gathers the components of the matching ones
+	};
+
 	template<typename... T>
 	class ComponentView;
 
-	template<typename... IncludedTypes, typename... ExcludedTypes>
-	class ComponentView<TypeList<IncludedTypes...>, TypeList<ExcludedTypes...>>  final
+	template<typename... IncludedTypes, typename... ExcludedTypes, typename... Filters>
+	class ComponentView<TypeList<IncludedTypes...>, TypeList<ExcludedTypes...>, Filters...>  final
 	{
 		// Abbreviation of a type
 		using any_common_comps = has_any_common<TypeList<IncludedTypes...>, TypeList<ExcludedTypes...>>;
 
 		static_assert(sizeof...(IncludedTypes) > 0, "No included types found");
 		static_assert(!any_common_comps::value, "Included and excluded share a type");
+		static_assert((is_view_filter<Filters>::value && ...), "Filters must be Changed or Added");
+		static_assert((is_any_of_v<typename filtered_type<Filters>::type, IncludedTypes...> && ...), "Filtered types must be included");
+		static_assert(!(is_singleton<typename filtered_type<Filters>::type>::value || ...), "Singletons can't be filtered");
+		static_assert(!(is_singleton<ExcludedTypes>::value || ...), "Singletons are shared by every entity and can't be excluded");
+
+		// Pointers to the storage of every included type
+		using Included = std::tuple<included_storage_t<IncludedTypes>*...>;
 
 
 	public:
 		ComponentView() = delete;
-		ComponentView(ComponentPool<IncludedTypes>*... includedPools, ComponentPool<ExcludedTypes>*... excludedPools) : 
-			m_includedPools{ includedPools... }, m_excludedPools{ excludedPools... } {}
+		ComponentView(ArchetypeStorage* archetypes, const std::pmr::vector<Bitmask>* masks, const BaseComponentGroup* group, included_storage_t<IncludedTypes>*... included, ComponentPool<ExcludedTypes>*... excludedPools, Filters... filters) : 
+			m_archetypes(archetypes), m_masks(masks), m_group(group), m_included{ included... }, m_excludedPools{ excludedPools... }, m_filters{ filters... } {}
 		ComponentView(const ComponentView& other) = default;
 		~ComponentView() = default;
 		ComponentView& operator=(const ComponentView& other) = default;
 
 		// Performs the passed function on each entity with all of the included components and none of the exlcuded ones
-		// The included components are sent as reference arguments to the function
+		// The included components are sent as reference arguments to the function, preceded by the entity ID if wrapped by withEntityID
+		// Components of pools which track changes are marked as changed when passed by mutable reference
+		// Filters are applied by walking the first filtered pool. They let everything through when using archetypes, which don't track changes
+		// Singletons are read once before iterating, and a view of only singletons calls the function once, with NULL_ENTITY_ID as the ID
+		// Iterations are timed as Timer scopes named after the view's type IDs, as are those of for_each_entity_parallel and for_each_batch
+		// While Timer counters are enabled, the hardware events of the iteration and the entities it visits are counted as well
 		template<typename Function>
 		void for_each_entity(Function f)
 		{
-			(getPool<IncludedTypes>().components.sort(), ...);
+			const Timer::Scoped scope(s_timerLabel);
 
-			if constexpr (sizeof...(IncludedTypes) == 1)
+			if (Timer::areCountersEnabled())
 			{
-				if constexpr (sizeof...(ExcludedTypes) == 0)
-				{
-					iterateSingleWithoutExcludes(f);
-				}
-				else
+				const Timer::CountedScope counted(s_timerLabel);
+				CountedFunction<Function> countedFunction{ f, 0 };
+				iterate(countedFunction);
+				Timer::CountedScope::addEntities(countedFunction.count);
+			}
+			else
+			{
+				iterate(f);
+			}
+		}
+
+		// Performs the passed function like for_each_entity, but splits the entities into ranges which are run on the executor
+		// Ranges hold at most grainSize entities, except when using archetypes, where each chunk is one range
+		// The function is called from several threads at once, and must only touch the components it's passed
+		// The iteration is timed, but its hardware events aren't counted, as most of them happen on other threads
+		// Components must not be attached or detached, and entities must not be created or destroyed, until this returns
+		template<typename Function, typename Executor = Threading::ThreadPool>
+		void for_each_entity_parallel(Function f, const size_t grainSize, Executor& executor = Threading::ThreadPool::getDefault())
+		{
+			const Timer::Scoped scope(s_timerLabel);
+
+			if (!(isPoolPopulated<IncludedTypes>() && ...))
+			{
+				return;
+			}
+
+			if constexpr (ALL_SINGLETONS)
+			{
+				iterateSingletons(f);
+			}
+			else if (m_archetypes)
+			{
+				std::vector<std::pair<const Archetype*, size_t>> chunks;
+				for (const auto& archetype : m_archetypes->getArchetypes())
 				{
-					iterateSingleWithExcludes(f);
+					if (archetype->matches(ARCHETYPE_MASK, ARCHETYPE_EXCLUDED_MASK))
+					{
+						for (size_t chunk = 0; chunk < archetype->chunkCount(); chunk++)
+						{
+							chunks.emplace_back(archetype.get(), chunk);
+						}
+					}
 				}
+
+				executor.parallelFor(chunks.size(), 1, [this, &f, &chunks](const size_t begin, const size_t end)
+					{
+						for (size_t i = begin; i < end; i++)
+						{
+							iterateArchetypeChunk(f, *chunks[i].first, chunks[i].second);
+						}
+					});
 			}
 			else
 			{
-				if constexpr (sizeof...(ExcludedTypes) == 0)
+				iteratePoolsParallel(f, grainSize, executor);
+			}
+		}
+
+		// Performs the passed function on batches of contiguous components, which lets systems be vectorized
+		// The function is sent the batch size, followed by the start of each included type's components:
+		// a pointer to the first component, or a span of each field for types stored as structure-of-arrays
+		// Only views of a single type, or of exactly the types of a group, can be batched. Returns false if this view can't be
+		// Every component of a pool which tracks changes is marked as changed, as the function could write to any of them
+		template<typename Function>
+		bool for_each_batch(Function f)
+		{
+			static_assert(sizeof...(ExcludedTypes) == 0, "Views with excluded types can't be batched");
+			static_assert(sizeof...(Filters) == 0, "Filtered views can't be batched");
+			static_assert(!(is_singleton<IncludedTypes>::value || ...), "Views with singletons can't be batched");
+
+			const Timer::Scoped scope(s_timerLabel);
+			const Timer::CountedScope counted(s_timerLabel);
+
+			if (!(isPoolPopulated<IncludedTypes>() && ...))
+			{
+				return true;
+			}
+
+			if (m_archetypes)
+			{
+				// Archetypes store objects, meaning that fields can't be handed out as arrays
+				if constexpr ((has_soa_layout<IncludedTypes>::value || ...))
 				{
-					iterateMultiWithoutExcludes(f);
+					return false;
 				}
 				else
 				{
-					iterateMultiWithExcludes(f);
+					for (const auto& archetype : m_archetypes->getArchetypes())
+					{
+						if (!archetype->matches(ARCHETYPE_MASK, ComponentMask()))
+						{
+							continue;
+						}
+
+						for (size_t chunk = 0; chunk < archetype->chunkCount(); chunk++)
+						{
+							Timer::CountedScope::addEntities(archetype->chunkSize(chunk));
+							f(archetype->chunkSize(chunk), archetype->template column<IncludedTypes>(chunk, archetype->columnOf(IncludedTypes::TYPE_ID))...);
+						}
+					}
+					return true;
 				}
 			}
+
+			if (!m_group && sizeof...(IncludedTypes) > 1)
+			{
+				return false;
+			}
+
+			const size_t size = (m_group ? m_group->size() : drivingPoolSize(0));
+			Timer::CountedScope::addEntities(size);
+			f(size, getPool<IncludedTypes>().getDenseBase()...);
+			(getPool<IncludedTypes>().components.markAllChanged(), ...);
+			return true;
+		}
+
+		// Forces a way of finding entities, which is mostly useful for benchmarks. Ignored when using archetypes
+		ComponentView& setIterationStrategy(const IterationStrategy strategy) noexcept
+		{
+			m_strategy = strategy;
+			return *this;
 		}
 
 		// Retrieves a pointer to a component of type T which is attached to an entity with the specified ID
 		// TODO: More work
 		template<typename CompType>
-		CompType* get(const EntityID entityID)
+		ComponentPointer<CompType> get(const EntityID entityID)
 		{
 			static_assert(is_any_of_v<CompType, IncludedTypes...>, "CompType is not an included type");
 
 			if constexpr (is_singleton<CompType>::value)
 			{
-				return getPool<CompType>().components.get(0);
+				return std::get<CompType*>(m_included);
 			}
 			else
 			{
-				return getPool<CompType>().components.get(entityID);
+				if (m_archetypes)
+				{
+					return ComponentPool<CompType>::pointerTo(m_archetypes->get<CompType>(entityID));
+				}
+				ComponentPool<CompType>* pool = std::get<ComponentPool<CompType>*>(m_included);
+				return (pool ? pool->components.get(entityID) : nullptr);
 			}
 		}
 
@@ -95,16 +298,78 @@ namespace ECS
 		static constexpr Bitmask EXCLUDED_MASK = calculateMask<ExcludedTypes...>();
 
 	private:
+		static constexpr bool ALL_SINGLETONS = (is_singleton<IncludedTypes>::value && ...);
+		static constexpr bool HAS_SINGLETONS = (is_singleton<IncludedTypes>::value || ...);
+
+		// Mask of the included types which are stored in archetypes
+		static constexpr Bitmask ARCHETYPE_MASK = ((is_singleton<IncludedTypes>::value ? ComponentMask() : ComponentMask::of(IncludedTypes::TYPE_ID)) | ...);
+		static constexpr Bitmask ARCHETYPE_EXCLUDED_MASK = EXCLUDED_MASK;
+
+		// Masks aren't needed to find singletons, which are the same for every entity
+		static constexpr bool CAN_SCAN_MASKS = !ALL_SINGLETONS;
+
+		// Number of included types which are looked up per entity, as singletons are never looked up
+		static constexpr size_t LOOKED_UP_COUNT = ((is_singleton<IncludedTypes>::value ? 0 : 1) + ...);
+
+		// Cost of testing one mask, relative to looking up an entity in a pool
+		static constexpr double MASK_TEST_COST = 1.0;
+
+		// Number of masks tested before gathering the components of the matching entities
+		static constexpr size_t MASK_SCAN_BLOCK_SIZE = 256;
+
+		// Position of the included type whose pool drives filtered iteration, which is the type of the first filter
+		static constexpr size_t FILTER_DRIVER = type_to_index<typename filtered_type<typename int_to_type<0, Filters..., Changed<void>>::type>::type, IncludedTypes..., void>::value;
+
+		template<typename Func>
+		void iterate(Func& f)
+		{
+			// Nothing can match if any included pool is missing or empty
+			if (!(isPoolPopulated<IncludedTypes>() && ...))
+			{
+				return;
+			}
+
+			if constexpr (ALL_SINGLETONS)
+			{
+				iterateSingletons(f);
+			}
+			else if (m_archetypes)
+			{
+				iterateArchetypes(f);
+			}
+			else
+			{
+				iteratePools(f);
+			}
+		}
+
+		// Name of the Timer label of the view, such as "View<1, 0> without <2>"
+		static std::string timerName()
+		{
+			return typeIDList<IncludedTypes...>("View") + (sizeof...(ExcludedTypes) > 0 ? typeIDList<ExcludedTypes...>(" without ") : std::string());
+		}
+		template<typename... T>
+		static std::string typeIDList(const char* prefix)
+		{
+			std::string list = prefix;
+			list += '<';
+			((list += std::to_string(T::TYPE_ID) + ", "), ...);
+			list.resize(list.size() - 2);
+			list += '>';
+			return list;
+		}
+
 		template<typename CompType>
 		ComponentPool<CompType>& getPool()
 		{
 			constexpr bool is_included = is_any_of_v<CompType, IncludedTypes...>;
 			constexpr bool is_excluded = is_any_of_v<CompType, ExcludedTypes...>;
 			static_assert(static_cast<bool>(is_included || is_excluded), "CompType is not an included or excluded type");
+			static_assert(!is_singleton<CompType>::value, "Singletons have no pool");
 
 			if constexpr (is_included)
 			{
-				return *std::get<ComponentPool<CompType>*>(m_includedPools);
+				return *std::get<ComponentPool<CompType>*>(m_included);
 			}
 			else // This else MUST remain, due to compile-time checks
 			{
@@ -113,79 +378,574 @@ namespace ECS
 		}
 
 		template<typename Func>
-		void iterateSingleWithoutExcludes(Func f)
+		void iterateSingletons(Func& f)
+		{
+			const EntityID entityID = NULL_ENTITY_ID;
+			invoke(f, &entityID, 0, *std::get<IncludedTypes*>(m_included)...);
+		}
+
+		template<typename Func>
+		void iteratePools(Func& f)
+		{
+			m_marksWrites = (marksWritesTo<Func, IncludedTypes>() || ...);
+
+			if constexpr (sizeof...(Filters) > 0)
+			{
+				iterateDrivenRange<Func>(FILTER_DRIVER, f, 0, drivingPoolSize(FILTER_DRIVER));
+			}
+			else if (scansMasks())
+			{
+				iterateMaskScan(f, 0, m_masks->size());
+			}
+			else if (m_group)
+			{
+				iterateGroup(f, 0, m_group->size());
+			}
+			else if constexpr (sizeof...(IncludedTypes) == 1 && sizeof...(ExcludedTypes) == 0)
+			{
+				iterateSingleWithoutExcludes(f, 0, drivingPoolSize(0));
+			}
+			else
+			{
+				const size_t driver = findDriver();
+				iterateDrivenRange<Func>(driver, f, 0, drivingPoolSize(driver));
+			}
+		}
+		template<typename Func, typename Executor>
+		void iteratePoolsParallel(Func& f, const size_t grainSize, Executor& executor)
+		{
+			m_marksWrites = (marksWritesTo<Func, IncludedTypes>() || ...);
+
+			if constexpr (sizeof...(Filters) > 0)
+			{
+				executor.parallelFor(drivingPoolSize(FILTER_DRIVER), grainSize, [this, &f](const size_t begin, const size_t end)
+					{
+						iterateDrivenRange<Func>(FILTER_DRIVER, f, begin, end);
+					});
+			}
+			else if (scansMasks())
+			{
+				executor.parallelFor(m_masks->size(), grainSize, [this, &f](const size_t begin, const size_t end) { iterateMaskScan(f, begin, end); });
+			}
+			else if (m_group)
+			{
+				executor.parallelFor(m_group->size(), grainSize, [this, &f](const size_t begin, const size_t end) { iterateGroup(f, begin, end); });
+			}
+			else if constexpr (sizeof...(IncludedTypes) == 1 && sizeof...(ExcludedTypes) == 0)
+			{
+				executor.parallelFor(drivingPoolSize(0), grainSize, [this, &f](const size_t begin, const size_t end) { iterateSingleWithoutExcludes(f, begin, end); });
+			}
+			else
+			{
+				const size_t driver = findDriver();
+				executor.parallelFor(drivingPoolSize(driver), grainSize, [this, &f, driver](const size_t begin, const size_t end)
+					{
+						iterateDrivenRange<Func>(driver, f, begin, end);
+					});
+			}
+		}
+
+		template<typename Func>
+		void iterateArchetypes(Func f)
+		{
+			// Walk every chunk of every archetype with the correct components, with one column pointer per included type
+			for (const auto& archetype : m_archetypes->getArchetypes())
+			{
+				if (!archetype->matches(ARCHETYPE_MASK, ARCHETYPE_EXCLUDED_MASK))
+				{
+					continue;
+				}
+
+				const size_t chunkCount = archetype->chunkCount();
+				for (size_t chunk = 0; chunk < chunkCount; chunk++)
+				{
+					iterateArchetypeChunk(f, *archetype, chunk);
+				}
+			}
+		}
+		template<typename Func>
+		void iterateArchetypeChunk(Func& f, const Archetype& archetype, const size_t chunk)
+		{
+			const std::tuple<IncludedTypes*...> chunkColumns{ chunkColumnOf<IncludedTypes>(archetype, chunk, archetypeColumnOf<IncludedTypes>(archetype))... };
+			const size_t size = archetype.chunkSize(chunk);
+
+			const EntityID* entities = archetype.entities(chunk);
+
+			for (size_t row = 0; row < size; row++)
+			{
+				invoke(f, entities, row, componentInColumn<IncludedTypes>(std::get<IncludedTypes*>(chunkColumns), row)...);
+			}
+		}
+
+		// Column index of a type within an archetype, wrapped per type to allow lookup by type in a tuple
+		template<typename CompType>
+		struct ColumnOf
+		{
+			size_t index;
+		};
+		template<typename CompType>
+		ColumnOf<CompType> archetypeColumnOf(const Archetype& archetype) const
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return { Archetype::NO_COLUMN };
+			}
+			else
+			{
+				return { archetype.columnOf(CompType::TYPE_ID) };
+			}
+		}
+		template<typename CompType>
+		CompType* chunkColumnOf(const Archetype& archetype, const size_t chunk, const ColumnOf<CompType> column)
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return std::get<CompType*>(m_included);
+			}
+			else
+			{
+				return archetype.column<CompType>(chunk, column.index);
+			}
+		}
+		template<typename CompType>
+		static decltype(auto) componentInColumn(CompType* column, const size_t row)
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return *column;
+			}
+			else if constexpr (has_soa_layout<CompType>::value)
+			{
+				// Archetypes store every type as objects, but functions expect structure-of-arrays references
+				return SoAColumns<CompType>::refOf(column[row]);
+			}
+			else
+			{
+				return (column[row]);
+			}
+		}
+
+		// Calls the function with the components, preceded by the ID of the entity if the function wants it
+		// The ID is only read from the array when it's used
+		template<typename Func, typename ID, typename... Components>
+		static void invoke(Func& f, const ID*, const size_t, Components&&... components)
+		{
+			f(std::forward<Components>(components)...);
+		}
+		template<typename Func, typename ID, typename... Components>
+		static void invoke(WithEntityID<Func>& f, const ID* entities, const size_t index, Components&&... components)
+		{
+			f.function(static_cast<EntityID>(entities[index]), std::forward<Components>(components)...);
+		}
+		template<typename Func, typename ID, typename... Components>
+		static void invoke(CountedFunction<Func>& f, const ID* entities, const size_t index, Components&&... components)
+		{
+			f.count++;
+			invoke(f.function, entities, index, std::forward<Components>(components)...);
+		}
+
+		// The ranges below are dense indices of the iterated pool, which lets them be split between threads
+		template<typename Func>
+		void iterateSingleWithoutExcludes(Func& f, const size_t begin, const size_t end)
 		{
 			// Iterate components from the first included pool directly
-			auto& components = std::get<0>(m_includedPools)->components.getElements();
+			auto& pool = *std::get<0>(m_included);
+			const auto components = pool.getDenseBase();
+			const auto* entities = pool.components.getElemToIndex().data();
 
-			for (auto& comp : components)
+			for (size_t i = begin; i < end; i++)
 			{
-				f(comp);
+				invoke(f, entities, i, components[i]);
+				markWrites<Func>(entities[i]);
 			}
 		}
 		template<typename Func>
-		void iterateSingleWithExcludes(Func f)
+		void iterateGroup(Func& f, const size_t begin, const size_t end)
 		{
-			// Iterate components from the first included pool directly and retrieve entity indices to check excluded components
-			auto& sparseSet = std::get<0>(m_includedPools)->components;
-			auto& components = sparseSet.getElements();
-			const auto& elemToIndex = sparseSet.getElemToIndex();
-			const size_t size = sparseSet.size();
+			// Groups never own singletons, meaning that views with singletons have no group
+			if constexpr (!HAS_SINGLETONS)
+			{
+				// The grouped entities are stored first in every included pool, in the same order
+				const std::tuple<typename ComponentPool<IncludedTypes>::DenseBase...> components{ getPool<IncludedTypes>().getDenseBase()... };
+				const auto* entities = std::get<0>(m_included)->components.getElemToIndex().data();
 
-			for (size_t i = 0; i < size; i++)
+				if constexpr (sizeof...(ExcludedTypes) == 0)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						invoke(f, entities, i, std::get<typename ComponentPool<IncludedTypes>::DenseBase>(components)[i]...);
+						markWrites<Func>(entities[i]);
+					}
+				}
+				else
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						const bool hasAnyExcluded = (hasExcluded<ExcludedTypes>(entities[i]) || ...);
+						if (!hasAnyExcluded)
+						{
+							invoke(f, entities, i, std::get<typename ComponentPool<IncludedTypes>::DenseBase>(components)[i]...);
+							markWrites<Func>(entities[i]);
+						}
+					}
+				}
+			}
+		}
+
+		bool scansMasks()
+		{
+			if constexpr (!CAN_SCAN_MASKS)
 			{
-				const auto entityIndex = elemToIndex[i];
-				const bool hasAnyExcluded = (getPool<ExcludedTypes>().components.has(entityIndex) || ...);
-				if (!hasAnyExcluded)
+				return false;
+			}
+			else
+			{
+				switch (m_strategy)
 				{
-					f(components[i]);
+				case IterationStrategy::MaskScan:
+					return true;
+				case IterationStrategy::DrivenByPool:
+					return false;
+				default:
+					// Groups and single pools are walked without probing, which scanning can't beat
+					if (m_group || (sizeof...(IncludedTypes) == 1 && sizeof...(ExcludedTypes) == 0))
+					{
+						return false;
+					}
+					return isMaskScanCheaper();
 				}
 			}
 		}
+		bool isMaskScanCheaper()
+		{
+			// Costs are counted in pool lookups, and the number of matches is estimated as if the types were independent of each other
+			// Driving probes every other included pool and every excluded pool for each entity of the driver,
+			// while scanning tests every mask and looks up every included component of the matches
+			const double entityCount = static_cast<double>(m_masks->size());
+			const double driverSize = static_cast<double>(drivingPoolSize(findDriver()));
+
+			double matchRatio = 1.0;
+			((matchRatio *= includedRatio<IncludedTypes>(entityCount)), ...);
+			((matchRatio *= 1.0 - excludedRatio<ExcludedTypes>(entityCount)), ...);
+
+			const double probeCost = driverSize * static_cast<double>(LOOKED_UP_COUNT - 1 + sizeof...(ExcludedTypes));
+			const double scanCost = entityCount * MASK_TEST_COST + entityCount * matchRatio * static_cast<double>(LOOKED_UP_COUNT);
+			return (scanCost < probeCost);
+		}
+		// Share of all entities which have a component of the type
+		template<typename CompType>
+		double includedRatio(const double entityCount)
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return 1.0;
+			}
+			else
+			{
+				return static_cast<double>(getPool<CompType>().components.size()) / entityCount;
+			}
+		}
+		template<typename CompType>
+		double excludedRatio(const double entityCount)
+		{
+			const ComponentPool<CompType>* pool = std::get<ComponentPool<CompType>*>(m_excludedPools);
+			return (pool ? std::min(1.0, static_cast<double>(pool->components.size()) / entityCount) : 0.0);
+		}
 		template<typename Func>
-		void iterateMultiWithoutExcludes(Func f)
+		void iterateMaskScan(Func& f, const size_t begin, const size_t end)
 		{
-			// Iterate entity indices from the first included pool and check all included components
-			auto& sparseSet = std::get<0>(m_includedPools)->components;
-			const auto& elemToIndex = sparseSet.getElemToIndex();
-			const size_t size = sparseSet.size();
+			// Masks of every entity in a block are tested first, without branching, and the matching ones are gathered afterwards
+			const Bitmask* masks = m_masks->data();
+			const Included included = m_included;
+			EntityID matching[MASK_SCAN_BLOCK_SIZE];
 
-			for (size_t i = 0; i < size; i++)
+			for (size_t blockBegin = begin; blockBegin < end; blockBegin += MASK_SCAN_BLOCK_SIZE)
 			{
-				const auto entityIndex = elemToIndex[i];
-				const bool hasAllIncluded = (getPool<IncludedTypes>().components.has(entityIndex) || ...);
-				if (hasAllIncluded)
+				const size_t blockEnd = std::min(blockBegin + MASK_SCAN_BLOCK_SIZE, end);
+
+				size_t matchCount = 0;
+				for (size_t entityID = blockBegin; entityID < blockEnd; entityID++)
+				{
+					matching[matchCount] = static_cast<EntityID>(entityID);
+					matchCount += static_cast<size_t>(masks[entityID].matches(ARCHETYPE_MASK, ARCHETYPE_EXCLUDED_MASK));
+				}
+
+				for (size_t i = 0; i < matchCount; i++)
 				{
-					f(*getPool<IncludedTypes>().components.get(entityIndex)...);
+					invoke(f, matching, i, gatherMatching<IncludedTypes>(included, matching[i])...);
+					markWrites<Func>(matching[i]);
 				}
 			}
 		}
+
+		// Component of an entity whose mask says that it has one
+		template<typename CompType>
+		static decltype(auto) gatherMatching(const Included& included, const EntityID entityID)
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return *std::get<CompType*>(included);
+			}
+			else
+			{
+				return *std::get<ComponentPool<CompType>*>(included)->components.getExisting(entityID);
+			}
+		}
+
+		// Position of the included type whose pool drives iteration
+		size_t findDriver()
+		{
+			// Choose the smallest pool as the driver, as every other pool is only probed for the driver's entities
+			// Singletons are never chosen, as views of only singletons don't iterate pools
+			size_t driver = 0;
+			size_t smallestSize = static_cast<size_t>(-1);
+			size_t position = 0;
+			(considerDriver<IncludedTypes>(position++, driver, smallestSize), ...);
+			return driver;
+		}
+		size_t drivingPoolSize(const size_t driver)
+		{
+			static constexpr size_t (ComponentView::*s_sizes[])() = { &ComponentView::poolSize<IncludedTypes>... };
+			return (this->*s_sizes[driver])();
+		}
+		template<typename CompType>
+		size_t poolSize()
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return 1;
+			}
+			else
+			{
+				return getPool<CompType>().components.size();
+			}
+		}
+
 		template<typename Func>
-		void iterateMultiWithExcludes(Func f)
+		void iterateDrivenRange(const size_t driver, Func& f, const size_t begin, const size_t end)
 		{
-			// Iterate entity indices from the first included pool and check all included and excluded components
-			auto& sparseSet = std::get<0>(m_includedPools)->components;
-			const auto& elemToIndex = sparseSet.getElemToIndex();
-			const size_t size = sparseSet.size();
+			using DrivenIteration = void (ComponentView::*)(Func&, size_t, size_t);
+			static constexpr DrivenIteration s_iterations[] = { &ComponentView::iterateDrivenBy<IncludedTypes, Func>... };
+			(this->*s_iterations[driver])(f, begin, end);
+		}
+		template<typename Driver, typename Func>
+		void iterateDrivenBy(Func& f, const size_t begin, const size_t end)
+		{
+			// Singletons never drive, see findDriver
+			if constexpr (!is_singleton<Driver>::value)
+			{
+				// Iterate entity indices of the driving pool and look up the other included components and excluded ones
+				// The storage pointers are copied first, which keeps singletons in registers instead of being reloaded for every entity
+				const Included included = m_included;
+				auto& sparseSet = std::get<ComponentPool<Driver>*>(included)->components;
+				const auto& elemToIndex = sparseSet.getElemToIndex();
+
+				for (size_t i = begin; i < end; i++)
+				{
+					const auto entityIndex = elemToIndex[i];
+
+					if constexpr (sizeof...(Filters) > 0)
+					{
+						if (!passesFilters<Driver>(entityIndex, i))
+						{
+							continue;
+						}
+					}
+
+					const std::tuple<ComponentPointer<IncludedTypes>...> components{ findIncluded<Driver, IncludedTypes>(included, entityIndex, i)... };
+					const bool hasAllIncluded = ((is_singleton<IncludedTypes>::value || std::get<ComponentPointer<IncludedTypes>>(components) != nullptr) && ...);
+					if (!hasAllIncluded)
+					{
+						continue;
+					}
+
+					const bool hasAnyExcluded = (hasExcluded<ExcludedTypes>(entityIndex) || ...);
+					if (!hasAnyExcluded)
+					{
+						invoke(f, &entityIndex, 0, *std::get<ComponentPointer<IncludedTypes>>(components)...);
+						markWrites<Func>(entityIndex);
+					}
+				}
+			}
+		}
 
-			for (size_t i = 0; i < size; i++)
+		// True if the function could modify components of the type through its parameter, which is assumed if the parameters are unknown
+		template<typename Func, typename CompType>
+		static constexpr bool mayWrite()
+		{
+			using Function = typename unwrapped_function<Func>::type;
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return false;
+			}
+			else if constexpr (!has_function_arguments<Function>::value)
+			{
+				return true;
+			}
+			else
+			{
+				constexpr size_t position = unwrapped_function<Func>::FIRST_COMPONENT + type_to_index<CompType, IncludedTypes...>::value;
+				return !is_read_only_parameter<std::tuple_element_t<position, function_arguments_t<Function>>, CompType>::value;
+			}
+		}
+		template<typename Func, typename CompType>
+		bool marksWritesTo()
+		{
+			if constexpr (mayWrite<Func, CompType>())
+			{
+				return getPool<CompType>().components.tracksTicks();
+			}
+			else
+			{
+				return false;
+			}
+		}
+		// Stamps the components which the function could have modified
+		template<typename Func>
+		void markWrites(const EntityID entityID)
+		{
+			if (m_marksWrites)
+			{
+				(markWritten<Func, IncludedTypes>(entityID), ...);
+			}
+		}
+		template<typename Func, typename CompType>
+		void markWritten(const EntityID entityID)
+		{
+			if constexpr (mayWrite<Func, CompType>())
+			{
+				getPool<CompType>().components.markChanged(entityID);
+			}
+		}
+
+		template<typename Driver>
+		bool passesFilters(const EntityID entityID, const size_t driverIndex)
+		{
+			return std::apply([this, entityID, driverIndex](const Filters&... filters) { return (passesFilter<Driver>(filters, entityID, driverIndex) && ...); }, m_filters);
+		}
+		template<typename Driver, typename CompType>
+		bool passesFilter(const Changed<CompType>& filter, const EntityID entityID, const size_t driverIndex)
+		{
+			const auto* ticks = filteredTicks<Driver, CompType>(entityID, driverIndex);
+			return (!ticks || ticks->changed > filter.since);
+		}
+		template<typename Driver, typename CompType>
+		bool passesFilter(const Added<CompType>& filter, const EntityID entityID, const size_t driverIndex)
+		{
+			const auto* ticks = filteredTicks<Driver, CompType>(entityID, driverIndex);
+			return (!ticks || ticks->added > filter.since);
+		}
+		// Ticks of an entity's component, or null if the pool doesn't track them or the entity has no component
+		template<typename Driver, typename CompType>
+		const typename SparseSet<CompType>::ElementTicks* filteredTicks(const EntityID entityID, const size_t driverIndex)
+		{
+			const auto& components = getPool<CompType>().components;
+			if (!components.tracksTicks())
+			{
+				return nullptr;
+			}
+
+			if constexpr (std::is_same_v<Driver, CompType>)
+			{
+				return &components.ticksAt(driverIndex);
+			}
+			else
+			{
+				const auto denseIndex = components.denseIndexOf(entityID);
+				return (denseIndex != -1 ? &components.ticksAt(static_cast<size_t>(denseIndex)) : nullptr);
+			}
+		}
+
+		template<typename CompType>
+		void considerDriver(const size_t position, size_t& driver, size_t& smallestSize)
+		{
+			if constexpr (!is_singleton<CompType>::value)
+			{
+				const size_t size = getPool<CompType>().components.size();
+				if (size < smallestSize)
+				{
+					smallestSize = size;
+					driver = position;
+				}
+			}
+		}
+
+		// Included component of an entity, or null if it doesn't have one. The driver's component is known by its dense index
+		template<typename Driver, typename CompType>
+		static ComponentPointer<CompType> findIncluded(const Included& included, const EntityID entityID, const size_t driverIndex)
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return std::get<CompType*>(included);
+			}
+			else if constexpr (std::is_same_v<Driver, CompType>)
+			{
+				if constexpr (has_soa_layout<CompType>::value)
+				{
+					return ComponentPointer<CompType>(std::get<ComponentPool<CompType>*>(included)->components.getElements().ref(driverIndex));
+				}
+				else
+				{
+					return &std::get<ComponentPool<CompType>*>(included)->components.getElements()[driverIndex];
+				}
+			}
+			else
 			{
-				const auto entityIndex = elemToIndex[i];
-				const bool hasAllIncluded = (getPool<IncludedTypes>().components.has(entityIndex) && ...);
-				const bool hasAnyExcluded = (getPool<ExcludedTypes>().components.has(entityIndex) || ...);
+				return std::get<ComponentPool<CompType>*>(included)->components.get(entityID);
+			}
+		}
 
-				const bool hasCorrectComponents = hasAllIncluded && !hasAnyExcluded;
+		// Missing excluded pools can't contain anything
+		template<typename CompType>
+		bool hasExcluded(const EntityID entityID)
+		{
+			const ComponentPool<CompType>* pool = std::get<ComponentPool<CompType>*>(m_excludedPools);
+			return (pool && pool->components.has(entityID));
+		}
 
-				if (hasCorrectComponents)
+		template<typename CompType>
+		bool isPoolPopulated() const
+		{
+			// Singletons only have to exist
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return (std::get<CompType*>(m_included) != nullptr);
+			}
+			else
+			{
+				// Non-singleton components don't use pools when using archetypes
+				if (m_archetypes)
 				{
-					f(*getPool<IncludedTypes>().components.get(entityIndex)...);
+					return true;
 				}
+
+				const ComponentPool<CompType>* pool = std::get<ComponentPool<CompType>*>(m_included);
+				return (pool && pool->components.size() > 0);
 			}
 		}
 
 	private:
-		// Pointers to any number of component pools of different types
-		const std::tuple<ComponentPool<IncludedTypes>*...> m_includedPools;
+		// Component storage when the manager uses archetypes, otherwise null
+		ArchetypeStorage* m_archetypes;
+
+		// Component mask of every entity, indexed by entity ID
+		const std::pmr::vector<Bitmask>* m_masks;
+
+		IterationStrategy m_strategy = IterationStrategy::Automatic;
+
+		// Group owning exactly the included types, if any
+		const BaseComponentGroup* m_group;
+
+		// Pointers to any number of component pools of different types, and to the singletons which are included
+		const Included m_included;
 		const std::tuple<ComponentPool<ExcludedTypes>*...> m_excludedPools;
+
+		const std::tuple<Filters...> m_filters;
+
+		// True while iterating with a function which could modify components of a pool tracking changes
+		bool m_marksWrites = false;
+
+		// Label shared by every view of the same types, interned during static initialization rather than checked on every iteration
+		inline static const Timer::Label s_timerLabel = Timer::intern(timerName());
 	};
 }
\ No newline at end of file
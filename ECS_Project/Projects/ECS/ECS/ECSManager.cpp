@@ -1,13 +1,39 @@
 #include "pch_ECS.hpp"
 #include "ECSManager.hpp"
+#include "Utilities/Serialization/MappedFile.hpp"
+#include <algorithm>
+#include <limits>
 
 namespace ECS
 {
+	ECSManager::ECSManager(const StorageMode mode, std::pmr::memory_resource* resource) :
+		m_resource(resource),
+		m_componentMasks(resource),
+		m_entitySlots(resource),
+		m_componentPools(resource),
+		m_entityTicks(resource)
+	{
+		if (mode == StorageMode::Archetype)
+		{
+			m_archetypes = std::make_unique<ArchetypeStorage>(resource);
+		}
+	}
+	ECSManager::ECSManager(std::pmr::memory_resource* resource) : ECSManager(StorageMode::SparseSet, resource)
+	{
+	}
 	ECSManager::~ECSManager()
 	{
+		m_groups.clear();
 		for (auto pool : m_componentPools)
 		{
-			delete pool;
+			if (pool)
+			{
+				pool->destroy();
+			}
+		}
+		for (size_t compTypeID = 0; compTypeID < m_singletons.size(); compTypeID++)
+		{
+			destroySingleton(static_cast<ComponentTypeID>(compTypeID));
 		}
 	}
 
@@ -25,69 +51,602 @@ namespace ECS
 			entityID = createNewEntity();
 		}
 
-		return Entity(entityID);
+		return Entity(entityID, m_entitySlots[entityID].generation);
 	}
-	[[nodiscard]] Bitmask ECSManager::getComponentMask(const EntityID entityID) const
+	void ECSManager::createEntities(const size_t count, Span<Entity> output)
 	{
-		return m_componentMasks[entityID];
+		const size_t total = std::min(count, output.size());
+		size_t created = 0;
+		while (created < total && hasInvalidEntities())
+		{
+			const EntityID entityID = getAndPopLastInvalidEntityID();
+			resetAndValidateEntity(entityID);
+			output[created++] = Entity(entityID, m_entitySlots[entityID].generation);
+		}
+
+		// Entities which can't reuse an ID are appended together
+		const size_t firstID = m_entitySlots.size();
+		const size_t remaining = total - created;
+		m_componentMasks.resize(firstID + remaining, ComponentMask());
+		m_entitySlots.resize(firstID + remaining);
+		if (m_tracksDeltas)
+		{
+			m_entityTicks.resize(firstID + remaining, m_tick);
+		}
+		for (size_t i = firstID; i < firstID + remaining; i++)
+		{
+			const EntityID entityID = static_cast<EntityID>(i);
+			m_entitySlots[i] = { entityID, 0 };
+			output[created++] = Entity(entityID, 0);
+		}
 	}
-	[[nodiscard]] bool ECSManager::isValid(const EntityID entityID) const
+	[[nodiscard]] Bitmask ECSManager::getComponentMask(const EntityID entityID) const
 	{
-		return m_isValidEntity[entityID];
+		return m_componentMasks[entityID];
 	}
 
 	void ECSManager::reserveEntities(const size_t COUNT)
 	{
 		m_componentMasks.reserve(COUNT);
-		m_isValidEntity.reserve(COUNT);
+		m_entitySlots.reserve(COUNT);
+		if (m_tracksDeltas)
+		{
+			m_entityTicks.reserve(COUNT);
+		}
 	}
 	void ECSManager::destroyEntity(const EntityID entityID)
 	{
 		if (isValid(entityID))
 		{
+			releaseComponents(Span<const EntityID>(&entityID, 1));
 			resetComponentMask(entityID);
 			invalidateEntity(entityID);
 		}
 	}
+	void ECSManager::destroyEntity(const Entity& entity)
+	{
+		if (isValid(entity))
+		{
+			destroyEntity(entity.ID);
+		}
+	}
+	void ECSManager::destroyEntities(Span<const EntityID> entityIDs)
+	{
+		destroyEntitiesOf(entityIDs);
+	}
+	void ECSManager::destroyEntities(Span<const Entity> entities)
+	{
+		destroyEntitiesOf(entities);
+	}
 	void ECSManager::clearEntities()
 	{
-		m_componentMasks.clear();
-		m_componentMasks.shrink_to_fit();
-		m_isValidEntity.clear();
-		m_isValidEntity.shrink_to_fit();
+		// Components in pools would otherwise outlive their entities, while archetypes are cleared as a whole
+		if (!m_archetypes)
+		{
+			std::vector<EntityID> validIDs;
+			for (size_t i = 0; i < m_entitySlots.size(); i++)
+			{
+				if (isValid(static_cast<EntityID>(i)))
+				{
+					validIDs.push_back(static_cast<EntityID>(i));
+				}
+			}
+			releaseComponents(validIDs);
+		}
+
+		if (m_archetypes)
+		{
+			m_archetypes->clear();
+		}
+
+		// Slots are kept with their generations increased, so that handles from before the clear stay invalid when IDs are reused
+		// The free list is rebuilt from the highest ID down, which reuses the lowest IDs first
+		m_lastInvalidEntityID = NULL_ENTITY_ID;
+		for (size_t i = m_entitySlots.size(); i-- > 0;)
+		{
+			const EntityID entityID = static_cast<EntityID>(i);
+			m_componentMasks[i] = ComponentMask();
+			if (isValid(entityID))
+			{
+				invalidateEntity(entityID);
+			}
+			else
+			{
+				m_entitySlots[i].next = m_lastInvalidEntityID;
+				m_lastInvalidEntityID = entityID;
+				touchEntity(entityID);
+			}
+		}
+		m_renumberTick = m_tick;
 	}
 	
+	void ECSManager::releaseComponents(Span<const EntityID> entityIDs)
+	{
+		if (m_archetypes)
+		{
+			for (const EntityID entityID : entityIDs)
+			{
+				m_archetypes->remove(entityID);
+			}
+		}
+
+		// A single entity is released directly from each pool its mask points at
+		if (entityIDs.size() == 1)
+		{
+			m_componentMasks[entityIDs[0]].forEachType([this, entityIDs](const ComponentTypeID compTypeID) { releaseFromPool(compTypeID, entityIDs); });
+			return;
+		}
+
+		// Several entities are sorted into one batch per pool first
+		std::vector<std::vector<EntityID>> releasedIDs(m_componentPools.size());
+		for (const EntityID entityID : entityIDs)
+		{
+			m_componentMasks[entityID].forEachType([this, &releasedIDs, entityID](const ComponentTypeID compTypeID)
+			{
+				if (compTypeID < releasedIDs.size())
+				{
+					releasedIDs[compTypeID].push_back(entityID);
+				}
+			});
+		}
+		for (size_t compTypeID = 0; compTypeID < releasedIDs.size(); compTypeID++)
+		{
+			if (!releasedIDs[compTypeID].empty())
+			{
+				releaseFromPool(static_cast<ComponentTypeID>(compTypeID), releasedIDs[compTypeID]);
+			}
+		}
+	}
+	void ECSManager::destroySingleton(const ComponentTypeID compTypeID) noexcept
+	{
+		SingletonSlot& slot = m_singletons[compTypeID];
+		if (slot.object)
+		{
+			slot.destroy(slot.object, m_resource);
+			slot = SingletonSlot();
+		}
+	}
+	void ECSManager::releaseFromPool(const ComponentTypeID compTypeID, Span<const EntityID> entityIDs)
+	{
+		// Components of archetype storage and singletons have no pool
+		BaseComponentPool* pool = (compTypeID < m_componentPools.size() ? m_componentPools[compTypeID] : nullptr);
+		if (!pool)
+		{
+			return;
+		}
+
+		// Grouped components have to be moved out of the group before their holes are filled
+		if (pool->group)
+		{
+			for (const EntityID entityID : entityIDs)
+			{
+				pool->group->onDetach(entityID);
+			}
+		}
+		pool->removeMany(entityIDs);
+	}
+
+	std::vector<EntityID> ECSManager::compact(const std::chrono::microseconds sortBudget)
+	{
+		std::vector<EntityID> newIDs(m_entitySlots.size(), NULL_ENTITY_ID);
+		EntityID liveCount = 0;
+		for (size_t oldID = 0; oldID < m_entitySlots.size(); oldID++)
+		{
+			if (isValid(static_cast<EntityID>(oldID)))
+			{
+				newIDs[oldID] = liveCount++;
+			}
+		}
+
+		// Entities only move to lower IDs, so the entity storage can be compacted in place
+		for (size_t oldID = 0; oldID < newIDs.size(); oldID++)
+		{
+			const EntityID newID = newIDs[oldID];
+			if (newID != NULL_ENTITY_ID)
+			{
+				m_componentMasks[newID] = m_componentMasks[oldID];
+				m_entitySlots[newID] = { newID, m_entitySlots[oldID].generation };
+			}
+		}
+		m_componentMasks.resize(static_cast<size_t>(liveCount));
+		m_componentMasks.shrink_to_fit();
+		m_entitySlots.resize(static_cast<size_t>(liveCount));
+		m_entitySlots.shrink_to_fit();
+		if (m_tracksDeltas)
+		{
+			m_entityTicks.assign(static_cast<size_t>(liveCount), m_tick);
+			m_entityTicks.shrink_to_fit();
+		}
+		m_lastInvalidEntityID = NULL_ENTITY_ID;
+		m_renumberTick = m_tick;
+
+		for (BaseComponentPool* pool : m_componentPools)
+		{
+			if (pool)
+			{
+				pool->remapEntities(newIDs);
+			}
+		}
+		if (m_archetypes)
+		{
+			m_archetypes->remapEntities(newIDs);
+		}
+
+		m_nextPoolToSort = 0;
+		sortPools(sortBudget);
+		return newIDs;
+	}
+	bool ECSManager::sortPools(const std::chrono::microseconds budget)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		while (m_nextPoolToSort < m_componentPools.size())
+		{
+			// Pools owned by a group are ordered by the group, which renumbering keeps intact
+			BaseComponentPool* pool = m_componentPools[m_nextPoolToSort++];
+			if (pool && !pool->group)
+			{
+				pool->sortByEntity();
+			}
+
+			if (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start) >= budget)
+			{
+				break;
+			}
+		}
+		return (m_nextPoolToSort >= m_componentPools.size());
+	}
+
+	namespace
+	{
+		// "ECSW" and "ECSD" in a little-endian file
+		constexpr std::uint32_t SNAPSHOT_MAGIC = 0x57534345;
+		constexpr std::uint32_t DELTA_MAGIC = 0x44534345;
+		constexpr std::uint32_t SNAPSHOT_VERSION = 1;
+
+		struct SnapshotHeader
+		{
+			std::uint32_t magic;
+			std::uint32_t version;
+			std::uint32_t maskBits;
+			std::uint32_t typeCount;
+			std::uint64_t entityCount;
+			EntityID lastInvalidEntityID;
+			Tick tick;
+		};
+
+		// Precedes the components of each type
+		struct StoredType
+		{
+			ComponentTypeID typeID;
+			std::uint16_t isSingleton;
+			std::uint32_t size;
+			std::uint32_t alignment;
+		};
+
+		// Array of count values of the given size, or null if the reader doesn't hold that many
+		const void* readArray(Serialization::BinaryReader& reader, const size_t size, const size_t alignment, const std::uint64_t count)
+		{
+			if (count > static_cast<std::uint64_t>(SIZE_MAX / size))
+			{
+				reader.fail();
+				return nullptr;
+			}
+			return reader.readBytes(size * static_cast<size_t>(count), alignment);
+		}
+	}
+
+	bool ECSManager::snapshot(const std::string& path) const
+	{
+		// Nothing is written if the snapshot would fail anyway
+		std::uint32_t typeCount = 0;
+		if (m_archetypes || !countSaveableTypes(typeCount))
+		{
+			return false;
+		}
+
+		Serialization::BinaryWriter writer(path);
+		return snapshot(writer) && writer.close();
+	}
+	bool ECSManager::snapshot(Serialization::BinaryWriter& writer) const
+	{
+		std::uint32_t typeCount = 0;
+		if (m_archetypes || !countSaveableTypes(typeCount))
+		{
+			return false;
+		}
+
+		const SnapshotHeader header = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, ECS_MASK_BITS, typeCount, m_entitySlots.size(), m_lastInvalidEntityID, m_tick };
+		writer.write(header);
+		writer.writeBytes(m_componentMasks.data(), sizeof(Bitmask) * m_componentMasks.size(), alignof(Bitmask));
+		writer.writeBytes(m_entitySlots.data(), sizeof(EntitySlot) * m_entitySlots.size(), alignof(EntitySlot));
+		saveTypes(writer, nullptr);
+		return writer.isGood();
+	}
+	bool ECSManager::restoreFrom(const std::string& path, Span<const TypeLoader> loaders)
+	{
+		const Serialization::MappedFile file(path);
+		Serialization::BinaryReader reader(file.data(), file.size());
+		return restoreFrom(reader, loaders);
+	}
+	bool ECSManager::restoreFrom(Serialization::BinaryReader& reader, Span<const TypeLoader> loaders)
+	{
+		if (m_archetypes || !m_groups.empty())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < m_entitySlots.size(); i++)
+		{
+			if (isValid(static_cast<EntityID>(i)))
+			{
+				return false;
+			}
+		}
+
+		SnapshotHeader header{};
+		reader.read(header);
+		if (header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION || header.maskBits != ECS_MASK_BITS ||
+			header.entityCount > static_cast<std::uint64_t>(std::numeric_limits<EntityID>::max()))
+		{
+			return false;
+		}
+
+		// Entity storage is copied as two whole arrays
+		const size_t entityCount = static_cast<size_t>(header.entityCount);
+		const Bitmask* masks = static_cast<const Bitmask*>(readArray(reader, sizeof(Bitmask), alignof(Bitmask), entityCount));
+		const EntitySlot* slots = static_cast<const EntitySlot*>(readArray(reader, sizeof(EntitySlot), alignof(EntitySlot), entityCount));
+		if (!reader.isGood())
+		{
+			return false;
+		}
+		m_componentMasks.assign(masks, masks + entityCount);
+		m_entitySlots.assign(slots, slots + entityCount);
+		m_lastInvalidEntityID = header.lastInvalidEntityID;
+		m_tick = header.tick;
+		if (m_tracksDeltas)
+		{
+			m_entityTicks.assign(entityCount, m_tick);
+		}
+
+		if (!loadTypes(reader, header.typeCount, loaders, false))
+		{
+			for (BaseComponentPool* pool : m_componentPools)
+			{
+				if (pool)
+				{
+					pool->clear();
+				}
+			}
+			clearEntities();
+			return false;
+		}
+		return true;
+	}
+
+	void ECSManager::trackDeltas()
+	{
+		if (m_tracksDeltas || m_archetypes)
+		{
+			return;
+		}
+
+		m_tracksDeltas = true;
+		m_entityTicks.assign(m_entitySlots.size(), m_tick);
+		for (BaseComponentPool* pool : m_componentPools)
+		{
+			if (pool)
+			{
+				pool->trackTicks(&m_tick);
+			}
+		}
+	}
+	bool ECSManager::writeDelta(Serialization::BinaryWriter& writer, const Tick since) const
+	{
+		std::uint32_t typeCount = 0;
+		if (!m_tracksDeltas || m_renumberTick > since || !countSaveableTypes(typeCount))
+		{
+			return false;
+		}
+
+		const SnapshotHeader header = { DELTA_MAGIC, SNAPSHOT_VERSION, ECS_MASK_BITS, typeCount, m_entitySlots.size(), m_lastInvalidEntityID, m_tick };
+		writer.write(header);
+
+		// Entities whose validity or mask changed, followed by their slots and masks
+		std::vector<EntityID> changedIDs;
+		for (size_t entityID = 0; entityID < m_entityTicks.size(); entityID++)
+		{
+			if (m_entityTicks[entityID] > since)
+			{
+				changedIDs.push_back(static_cast<EntityID>(entityID));
+			}
+		}
+		writer.write(static_cast<std::uint64_t>(changedIDs.size()));
+		writer.writeBytes(changedIDs.data(), sizeof(EntityID) * changedIDs.size(), alignof(EntityID));
+		writer.align(alignof(EntitySlot));
+		for (const EntityID entityID : changedIDs)
+		{
+			writer.writeBytes(&m_entitySlots[entityID], sizeof(EntitySlot));
+		}
+		writer.align(alignof(Bitmask));
+		for (const EntityID entityID : changedIDs)
+		{
+			writer.writeBytes(&m_componentMasks[entityID], sizeof(Bitmask));
+		}
+
+		saveTypes(writer, &since);
+		return writer.isGood();
+	}
+	bool ECSManager::applyDeltaFrom(Serialization::BinaryReader& reader, Span<const TypeLoader> loaders)
+	{
+		if (m_archetypes || !m_groups.empty())
+		{
+			return false;
+		}
+
+		SnapshotHeader header{};
+		reader.read(header);
+		if (header.magic != DELTA_MAGIC || header.version != SNAPSHOT_VERSION || header.maskBits != ECS_MASK_BITS ||
+			header.entityCount > static_cast<std::uint64_t>(std::numeric_limits<EntityID>::max()) || header.entityCount < m_entitySlots.size())
+		{
+			return false;
+		}
+
+		std::uint64_t changedCount = 0;
+		reader.read(changedCount);
+		const EntityID* changedIDs = static_cast<const EntityID*>(readArray(reader, sizeof(EntityID), alignof(EntityID), changedCount));
+		const EntitySlot* slots = static_cast<const EntitySlot*>(readArray(reader, sizeof(EntitySlot), alignof(EntitySlot), changedCount));
+		const Bitmask* masks = static_cast<const Bitmask*>(readArray(reader, sizeof(Bitmask), alignof(Bitmask), changedCount));
+		if (!reader.isGood() || std::any_of(changedIDs, changedIDs + changedCount, [&header](const EntityID entityID) { return entityID < 0 || static_cast<std::uint64_t>(entityID) >= header.entityCount; }))
+		{
+			return false;
+		}
+
+		// Entities are only ever appended between checkpoints
+		const size_t entityCount = static_cast<size_t>(header.entityCount);
+		m_componentMasks.resize(entityCount, ComponentMask());
+		m_entitySlots.resize(entityCount);
+		if (m_tracksDeltas)
+		{
+			m_entityTicks.resize(entityCount, m_tick);
+		}
+
+		// Components missing from the new masks are released in one batch per pool, like destroyed entities
+		std::vector<std::vector<EntityID>> detachedIDs(m_componentPools.size());
+		for (size_t i = 0; i < changedCount; i++)
+		{
+			const EntityID entityID = changedIDs[i];
+			(m_componentMasks[entityID] & ~masks[i]).forEachType([&detachedIDs, entityID](const ComponentTypeID compTypeID)
+			{
+				if (compTypeID < detachedIDs.size())
+				{
+					detachedIDs[compTypeID].push_back(entityID);
+				}
+			});
+			m_componentMasks[entityID] = masks[i];
+			m_entitySlots[entityID] = slots[i];
+			touchEntity(entityID);
+		}
+		for (size_t compTypeID = 0; compTypeID < detachedIDs.size(); compTypeID++)
+		{
+			if (!detachedIDs[compTypeID].empty())
+			{
+				releaseFromPool(static_cast<ComponentTypeID>(compTypeID), detachedIDs[compTypeID]);
+			}
+		}
+		m_lastInvalidEntityID = header.lastInvalidEntityID;
+
+		const bool isLoaded = loadTypes(reader, header.typeCount, loaders, true);
+		m_tick = header.tick;
+		return isLoaded;
+	}
+
+	void ECSManager::saveTypes(Serialization::BinaryWriter& writer, const Tick* since) const
+	{
+		for (size_t compTypeID = 0; compTypeID < m_componentPools.size() && writer.isGood(); compTypeID++)
+		{
+			if (const BaseComponentPool* pool = m_componentPools[compTypeID])
+			{
+				writer.write(StoredType{ static_cast<ComponentTypeID>(compTypeID), 0, static_cast<std::uint32_t>(pool->componentSize), static_cast<std::uint32_t>(pool->componentAlignment) });
+				if (since)
+				{
+					pool->saveChanges(writer, *since);
+				}
+				else
+				{
+					pool->save(writer);
+				}
+			}
+		}
+
+		// Singletons have no ticks, so deltas always carry all of them
+		for (size_t compTypeID = 0; compTypeID < m_singletons.size() && writer.isGood(); compTypeID++)
+		{
+			const SingletonSlot& slot = m_singletons[compTypeID];
+			if (slot.object)
+			{
+				writer.write(StoredType{ static_cast<ComponentTypeID>(compTypeID), 1, static_cast<std::uint32_t>(slot.size), static_cast<std::uint32_t>(slot.alignment) });
+				slot.save(slot.object, writer);
+			}
+		}
+	}
+	bool ECSManager::loadTypes(Serialization::BinaryReader& reader, const std::uint32_t typeCount, Span<const TypeLoader> loaders, const bool isDelta)
+	{
+		for (std::uint32_t i = 0; i < typeCount && reader.isGood(); i++)
+		{
+			StoredType stored{};
+			reader.read(stored);
+
+			const TypeLoader* loader = std::find_if(loaders.begin(), loaders.end(), [&stored](const TypeLoader& l) { return l.typeID == stored.typeID; });
+			const bool isMatching = (loader != loaders.end() && loader->isSingleton == (stored.isSingleton != 0) &&
+				loader->size == stored.size && loader->alignment == stored.alignment);
+			if (!isMatching || !(isDelta ? loader->loadChanges : loader->load)(*this, reader))
+			{
+				reader.fail();
+			}
+		}
+		return reader.isGood();
+	}
+	bool ECSManager::countSaveableTypes(std::uint32_t& typeCount) const noexcept
+	{
+		typeCount = 0;
+		for (const BaseComponentPool* pool : m_componentPools)
+		{
+			if (pool && !pool->canSave())
+			{
+				return false;
+			}
+			typeCount += (pool ? 1 : 0);
+		}
+		for (const SingletonSlot& slot : m_singletons)
+		{
+			if (slot.object && !slot.save)
+			{
+				return false;
+			}
+			typeCount += (slot.object ? 1 : 0);
+		}
+		return true;
+	}
+
 	bool ECSManager::hasInvalidEntities() const noexcept
 	{
-		return !m_invalidEntityIDs.empty();
+		return m_lastInvalidEntityID != NULL_ENTITY_ID;
 	}
 	EntityID ECSManager::getAndPopLastInvalidEntityID()
 	{
-		const EntityID ID = m_invalidEntityIDs.back();
-		m_invalidEntityIDs.pop_back();
+		const EntityID ID = m_lastInvalidEntityID;
+		m_lastInvalidEntityID = m_entitySlots[ID].next;
 		return ID;
 	}
 	EntityID ECSManager::createNewEntity()
 	{
 		const EntityID entityID = static_cast<EntityID>(m_componentMasks.size());
 
-		m_componentMasks.push_back(0ULL);
-		m_isValidEntity.push_back(true);
+		m_componentMasks.push_back(ComponentMask());
+		m_entitySlots.push_back({ entityID, 0 });
+		if (m_tracksDeltas)
+		{
+			m_entityTicks.push_back(m_tick);
+		}
 
 		return entityID;
 	}
 	void ECSManager::resetAndValidateEntity(const EntityID entityID)
 	{
 		resetComponentMask(entityID);
-		m_isValidEntity[entityID] = true;
+		m_entitySlots[entityID].next = entityID;
+		touchEntity(entityID);
 	}
 	void ECSManager::resetComponentMask(const EntityID entityID)
 	{
-		m_componentMasks[entityID] = 0ULL;
+		m_componentMasks[entityID] = ComponentMask();
+		touchEntity(entityID);
 	}
 	void ECSManager::invalidateEntity(const EntityID entityID)
 	{
-		m_invalidEntityIDs.push_back(entityID);
-		m_isValidEntity[entityID] = false;
+		// The generation is increased to make any remaining handles to this entity invalid
+		m_entitySlots[entityID].generation++;
+		m_entitySlots[entityID].next = m_lastInvalidEntityID;
+		m_lastInvalidEntityID = entityID;
+		touchEntity(entityID);
 	}
 }
\ No newline at end of file
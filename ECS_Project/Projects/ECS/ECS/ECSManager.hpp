@@ -1,62 +1,264 @@
 #pragma once
+#include <array>
+#include <chrono>
+#include <memory_resource>
+#include <string>
 #include "Entity.h"
 #include "Components/Component.hpp"
 #include "Components/ComponentPool.hpp"
+#include "Components/ComponentGroup.hpp"
 #include "Components/ComponentView.hpp"
+#include "Archetypes/ArchetypeStorage.hpp"
 #include "Utilities/HelperTemplates.hpp"
+#include "Utilities/Span.hpp"
+#include "Utilities/Serialization/BinaryReader.hpp"
+#include "Utilities/Serialization/BinaryWriter.hpp"
 #include "ECSTemplates.hpp"
 
 namespace ECS
 {
-	// Used to keep track of components of an entity
-	using Bitmask = size_t;
+	// How non-singleton components are stored
+	enum class StorageMode
+	{
+		SparseSet,	// One sparse set per component type
+		Archetype	// Entities with identical component masks share chunks, see ArchetypeStorage
+	};
 
 
 	class ECSManager final
 	{
 	public:
-		ECSManager() = default;
+		// Every entity and pool of the manager is allocated from the resource, which must outlive the manager
+		// Passing an ArenaResource or PoolResource keeps the world in memory of its own, without contention with other worlds
+		explicit ECSManager(const StorageMode mode = StorageMode::SparseSet, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+		explicit ECSManager(std::pmr::memory_resource* resource);
+		ECSManager(const ECSManager& other) = delete;
 		~ECSManager();
+		ECSManager& operator=(const ECSManager& other) = delete;
+
+		[[nodiscard]] std::pmr::memory_resource* getMemoryResource() const noexcept
+		{
+			return m_resource;
+		}
 
 		[[nodiscard]] Entity createEntity();
+		// Creates count entities, or as many as the output can hold, and writes their handles to the output
+		// Reuses destroyed IDs first, and grows the entity storage once for the rest
+		void createEntities(const size_t count, Span<Entity> output);
 		[[nodiscard]] Bitmask getComponentMask(const EntityID entityID) const;
-		[[nodiscard]] bool isValid(const EntityID entityID) const;
+
+		// True if the entity is alive, without checking which generation of it is referred to
+		[[nodiscard]] bool isValid(const EntityID entityID) const noexcept
+		{
+			return (static_cast<size_t>(entityID) < m_entitySlots.size() && m_entitySlots[entityID].next == entityID);
+		}
+		// True if the entity is alive and the handle refers to its current generation
+		[[nodiscard]] bool isValid(const Entity& entity) const noexcept
+		{
+			return (isValid(entity.ID) && m_entitySlots[entity.ID].generation == entity.generation);
+		}
+
+		// Handle to the current generation of an entity, or a null handle if the entity isn't alive
+		[[nodiscard]] Entity getEntity(const EntityID entityID) const noexcept
+		{
+			return (isValid(entityID) ? Entity(entityID, m_entitySlots[entityID].generation) : Entity());
+		}
 
 		void reserveEntities(const size_t COUNT);
+		// Destroying an entity releases all of its components, except shared singletons
 		void destroyEntity(const EntityID entityID);
+		void destroyEntity(const Entity& entity);
+		// Destroys several entities, releasing the components of each pool in one batch
+		// Invalid entities and entities which are passed several times are skipped
+		void destroyEntities(Span<const EntityID> entityIDs);
+		void destroyEntities(Span<const Entity> entities);
+		// Destroys every entity. Handles to them stay invalid, as their IDs are reused with new generations, starting from the lowest ID
 		void clearEntities();
 
-		template<typename... IncludedTypes, typename... ExcludedTypes>
-		[[nodiscard]] ComponentView<TypeList<IncludedTypes...>, TypeList<ExcludedTypes...>> getView(TypeList<ExcludedTypes...> = {})
+		// Renumbers the live entities to 0..N-1, keeping their order, and shrinks all entity and sparse storage to fit
+		// Pools which aren't owned by a group are then sorted to match, for as long as the budget allows, see sortPools
+		// Returns the new ID of every old ID, or NULL_ENTITY_ID for destroyed ones. Every stored ID must be patched with it,
+		// and handles can be patched with getEntity(newIDs[entity.ID]), which keeps their generation
+		std::vector<EntityID> compact(const std::chrono::microseconds sortBudget = std::chrono::microseconds::max());
+		// Continues sorting pools by entity ID, one pool at a time, until every pool is sorted or the budget has run out
+		// At least one pool is sorted per call. Returns true once every pool is sorted
+		bool sortPools(const std::chrono::microseconds budget = std::chrono::microseconds::max());
+
+		// View of the entities with every included type and none of the excluded ones, optionally filtered by Changed or Added
+		// Filtering a type starts tracking its changes, see trackChanges
+		template<typename... IncludedTypes, typename... ExcludedTypes, typename... Filters>
+		[[nodiscard]] ComponentView<TypeList<IncludedTypes...>, TypeList<ExcludedTypes...>, Filters...> getView(TypeList<ExcludedTypes...> = {}, Filters... filters)
 		{
 			static_assert(sizeof...(IncludedTypes) > 0, "No included types");
 			static_assert(!has_any_common<TypeList<IncludedTypes...>, TypeList<ExcludedTypes...>>::value, "Included and excluded share a type");
 
-			return { getPool<IncludedTypes>()..., getPool<ExcludedTypes>()... };
+			(trackChanges<typename filtered_type<Filters>::type>(), ...);
+			return { m_archetypes.get(), &m_componentMasks, findGroup<IncludedTypes...>(), getIncluded<IncludedTypes>()..., getPool<ExcludedTypes>()..., filters... };
+		}
+		template<typename... IncludedTypes, typename FirstFilter, typename... Filters, typename = std::enable_if_t<is_view_filter<FirstFilter>::value>>
+		[[nodiscard]] ComponentView<TypeList<IncludedTypes...>, TypeList<>, FirstFilter, Filters...> getView(FirstFilter filter, Filters... filters)
+		{
+			return getView<IncludedTypes...>(TypeList<>(), filter, filters...);
+		}
+
+		// Current tick, which components are stamped with when they're attached or modified through a view
+		[[nodiscard]] Tick getTick() const noexcept
+		{
+			return m_tick;
+		}
+		// Ends the current tick and returns it. A system filtering by Changed or Added should pass the tick returned after its previous iteration,
+		// which lets through everything changed since, including changes made later during the same frame
+		Tick advanceTick() noexcept
+		{
+			return m_tick++;
+		}
+		// Starts stamping the components of a type with the tick at which they were attached and last modified
+		// Components which already exist count as changed at the current tick. Archetype storage doesn't track changes
+		template<typename CompType>
+		void trackChanges()
+		{
+			static_assert(!is_singleton<CompType>::value, "Singletons can't be tracked");
+			if (m_archetypes)
+			{
+				return;
+			}
+
+			createPool<CompType>();
+			getPool<CompType>()->components.trackTicks(&m_tick);
+		}
+
+		// The singleton of a type, or null if it hasn't been created
+		template<typename CompType>
+		[[nodiscard]] CompType* getSingleton() const noexcept
+		{
+			static_assert(is_singleton<CompType>::value, "Not a singleton");
+			return static_cast<CompType*>(m_singletons[getID<CompType>()].object);
+		}
+		// Constructs the singleton of a type from the arguments, unless it already exists, and returns it
+		// Singletons live as long as the manager, and attaching one to an entity only marks the entity as having it
+		template<typename CompType, typename... Args>
+		CompType* createSingleton(Args&&... args)
+		{
+			static_assert(is_singleton<CompType>::value, "Not a singleton");
+			static_assert(!has_soa_layout<CompType>::value, "Singletons can't be stored as structure-of-arrays");
+
+			SingletonSlot& slot = m_singletons[getID<CompType>()];
+			if (!slot.object)
+			{
+				std::pmr::polymorphic_allocator<CompType> allocator(m_resource);
+				CompType* singleton = allocator.allocate(1);
+				try
+				{
+					allocator.construct(singleton, std::forward<Args>(args)...);
+				}
+				catch (...)
+				{
+					allocator.deallocate(singleton, 1);
+					throw;
+				}
+
+				slot.object = singleton;
+				slot.destroy = [](void* object, std::pmr::memory_resource* resource)
+				{
+					std::pmr::polymorphic_allocator<CompType> allocator(resource);
+					static_cast<CompType*>(object)->~CompType();
+					allocator.deallocate(static_cast<CompType*>(object), 1);
+				};
+				slot.size = sizeof(CompType);
+				slot.alignment = alignof(CompType);
+				if constexpr (Serialization::has_serialization_hooks<CompType>::value)
+				{
+					slot.save = [](const void* object, Serialization::BinaryWriter& writer) { static_cast<const CompType*>(object)->save(writer); };
+				}
+				else if constexpr (std::is_trivially_copyable_v<CompType>)
+				{
+					slot.save = [](const void* object, Serialization::BinaryWriter& writer) { writer.writeBytes(object, sizeof(CompType), alignof(CompType)); };
+				}
+			}
+			return static_cast<CompType*>(slot.object);
+		}
+
+		// Creates the pool of a type with its components allocated from another resource than the rest of the world, which must outlive the manager
+		// Passing a PoolResource on top of a MappedResource keeps the components in a file, which lets the OS page out cold types while heap pools of hot types stay resident
+		// Returns false if the pool already exists or archetypes are used
+		template<typename CompType>
+		bool setPoolResource(std::pmr::memory_resource* resource)
+		{
+			static_assert(!is_singleton<CompType>::value, "Singletons have no pool");
+
+			if (m_archetypes || hasPool<CompType>())
+			{
+				return false;
+			}
+
+			createPool<CompType>(resource);
+			return true;
+		}
+
+		// Lets the pools of the owned types be kept in the same order, so that views of exactly these types iterate without lookups
+		// A pool can only be owned by one group. Returns false if any pool is already owned or archetypes are used
+		template<typename... OwnedTypes>
+		bool registerGroup()
+		{
+			static_assert((is_component<OwnedTypes>::value && ...), "Not a component");
+
+			if (m_archetypes)
+			{
+				return false;
+			}
+
+			(createPool<OwnedTypes>(), ...);
+
+			const bool isAnyOwned = ((getPool<OwnedTypes>()->group != nullptr) || ...);
+			if (isAnyOwned)
+			{
+				return false;
+			}
+
+			m_groups.push_back(std::make_unique<ComponentGroup<OwnedTypes...>>(getPool<OwnedTypes>()...));
+			return true;
+		}
+
+		// Sorts the components of a type by entity ID, which improves the order of lookups into the pool
+		// Pools owned by a group are already ordered by the group and are left as they are
+		template<typename CompType>
+		void sortPool()
+		{
+			static_assert(!is_singleton<CompType>::value, "Singletons have no pool");
+
+			ComponentPool<CompType>* pool = getPool<CompType>();
+			if (pool && !pool->group)
+			{
+				pool->components.sort();
+			}
 		}
 
 		template<typename CompType>
 		[[nodiscard]] bool hasComponent(const Entity& entity) const
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
-			return hasComponent<CompType>(entity.ID);
+			return isValid(entity) && hasComponent<CompType>(entity.ID);
 		}
 		template<typename CompType>
 		[[nodiscard]] bool hasComponent(EntityID entityID) const
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
-			// 1 means maximum 32 bit shift. 1ULL means maximum 64 bit shift
-			return (m_componentMasks[entityID] & (1ULL << getID<CompType>()));
+			return m_componentMasks[entityID].test(getID<CompType>());
 		}
 
 		template<typename CompType, typename... Args>
-		[[maybe_unused]] CompType* attachComponent(const Entity& entity, Args&&... args)
+		[[maybe_unused]] ComponentPointer<CompType> attachComponent(const Entity& entity, Args&&... args)
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
+
+			if (!isValid(entity))
+			{
+				return nullptr;
+			}
 			return attachComponent<CompType, Args...>(entity.ID, std::forward<Args>(args)...);
 		}
 		template<typename CompType, typename... Args>
-		[[maybe_unused]] CompType* attachComponent(EntityID entityID, Args&&... args)
+		[[maybe_unused]] ComponentPointer<CompType> attachComponent(EntityID entityID, Args&&... args)
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
 
@@ -64,59 +266,181 @@ namespace ECS
 			{
 				return nullptr;
 			}
-			if (!hasPool<CompType>())
+			if constexpr (is_singleton<CompType>::value)
 			{
-				createPool<CompType>();
+				// The arguments are only used if the singleton doesn't exist yet
+				addToBitMask<CompType>(entityID);
+				return createSingleton<CompType>(std::forward<Args>(args)...);
 			}
-
-			ComponentPool<CompType>* pool = getPool<CompType>();
-
-			if constexpr (is_singleton<CompType>::value)
+			else
 			{
-				if (pool->components.size() == 0)
-				{
-					pool->components.add(0, std::forward<Args>(args)...);
-				}
-
-				if (!hasComponent<CompType>(entityID))
+				if (m_archetypes)
 				{
 					addToBitMask<CompType>(entityID);
+					return ComponentPool<CompType>::pointerTo(m_archetypes->attach<CompType>(entityID, std::forward<Args>(args)...));
 				}
 
-				return pool->components.get(0);
-			}
-			else
-			{
+				createPool<CompType>();
+				ComponentPool<CompType>* pool = getPool<CompType>();
+
 				if (!hasComponent<CompType>(entityID))
 				{
 					pool->components.add(entityID, std::forward<Args>(args)...);
 					addToBitMask<CompType>(entityID);
+
+					if (pool->group)
+					{
+						pool->group->onAttach(entityID);
+					}
 				}
 
 				return pool->components.get(entityID);
 			}
 		}
 
+		// Attaches a component constructed from the arguments to each of the entities, with storage reserved once
+		// Entities which are invalid or already have the component are skipped. Returns the number of attached components
+		template<typename CompType, typename... Args>
+		size_t attachComponents(Span<const EntityID> entityIDs, const Args&... args)
+		{
+			return attachComponentsTo<CompType>(entityIDs, [&args...](size_t) { return CompType(args...); });
+		}
+		template<typename CompType, typename... Args>
+		size_t attachComponents(Span<const Entity> entities, const Args&... args)
+		{
+			return attachComponentsTo<CompType>(entities, [&args...](size_t) { return CompType(args...); });
+		}
+
+		// Attaches a copy of the i:th component to the i:th entity, for each entity
+		template<typename CompType, typename Element>
+		std::enable_if_t<std::is_same_v<std::remove_const_t<Element>, CompType>, size_t> attachComponents(Span<const EntityID> entityIDs, Span<Element> components)
+		{
+			return attachComponentsTo<CompType>(entityIDs.subspan(0, std::min(entityIDs.size(), components.size())), [components](const size_t i) { return components[i]; });
+		}
+		template<typename CompType, typename Element>
+		std::enable_if_t<std::is_same_v<std::remove_const_t<Element>, CompType>, size_t> attachComponents(Span<const Entity> entities, Span<Element> components)
+		{
+			return attachComponentsTo<CompType>(entities.subspan(0, std::min(entities.size(), components.size())), [components](const size_t i) { return components[i]; });
+		}
+
 		template<typename CompType>
 		void detachComponent(const Entity& entity)
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
 
-			bool canBeDetached = isValid(entity.ID) && hasPool<CompType>() && hasComponent<CompType>(entity);
-			if (!canBeDetached)
+			if (isValid(entity))
 			{
-				return;
+				detachComponent<CompType>(entity.ID);
 			}
+		}
+		template<typename CompType>
+		void detachComponent(const EntityID entityID)
+		{
+			static_assert(is_component<CompType>::value, "Not a component");
 
-			ComponentPool<CompType>* pool = getPool<CompType>();
-			pool->components.remove(entity.ID);
-			removeFromBitMask<CompType>(entity.ID);
+			// Singletons are shared, so only the entity's mark is removed
+			if constexpr (is_singleton<CompType>::value)
+			{
+				if (isValid(entityID))
+				{
+					removeFromBitMask<CompType>(entityID);
+				}
+			}
+			else if (m_archetypes)
+			{
+				if (isValid(entityID) && hasComponent<CompType>(entityID))
+				{
+					m_archetypes->detach<CompType>(entityID);
+					removeFromBitMask<CompType>(entityID);
+				}
+			}
+			else
+			{
+				bool canBeDetached = isValid(entityID) && hasPool<CompType>() && hasComponent<CompType>(entityID);
+				if (!canBeDetached)
+				{
+					return;
+				}
+
+				ComponentPool<CompType>* pool = getPool<CompType>();
+				if (pool->group)
+				{
+					pool->group->onDetach(entityID);
+				}
+				pool->components.remove(entityID);
+				removeFromBitMask<CompType>(entityID);
+			}
 		}
 
 		template<typename CompType>
 		[[nodiscard]] size_t sizeOfPool() const
 		{
-			return getPool<CompType>()->components.size();
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return (getSingleton<CompType>() ? 1 : 0);
+			}
+			else if (m_archetypes)
+			{
+				return m_archetypes->count<CompType>();
+			}
+			else
+			{
+				return (hasPool<CompType>() ? getPool<CompType>()->components.size() : 0);
+			}
+		}
+
+		[[nodiscard]] StorageMode getStorageMode() const noexcept
+		{
+			return (m_archetypes ? StorageMode::Archetype : StorageMode::SparseSet);
+		}
+
+		// Writes every entity, component and singleton to a file or buffer which restore can load
+		// Masks, entity slots and the arrays of each pool are written as raw aligned sections, and each type is tagged with its ID, size and alignment
+		// Ticks and groups aren't saved. Returns false if archetypes are used, a stored type can't be saved, or the file can't be written
+		bool snapshot(const std::string& path) const;
+		bool snapshot(Serialization::BinaryWriter& writer) const;
+		// Loads a snapshot, where CompTypes must include every type stored in it
+		// A file is mapped, and each section of trivially copyable components is copied as a whole, while other types are loaded through their hooks
+		// Requires that no entities exist and no groups are registered, and saved singletons replace existing ones
+		// Entities get the generations they were saved with, meaning that handles from before the restore must not be kept
+		// Returns false if the snapshot can't be read or doesn't match the types, which leaves the manager without entities
+		template<typename... CompTypes>
+		bool restore(const std::string& path)
+		{
+			return restoreFrom(path, getLoaders<CompTypes...>());
+		}
+		template<typename... CompTypes>
+		bool restore(Serialization::BinaryReader& reader)
+		{
+			return restoreFrom(reader, getLoaders<CompTypes...>());
+		}
+
+		// Starts recording what writeDelta needs, which is the tick of each entity's last structural change, and the ticks of every pool
+		// Pools created later are tracked as well. Archetype storage doesn't track changes
+		void trackDeltas();
+		// Writes what changed after the tick, which is usually the tick returned by advanceTick at the previous checkpoint
+		// That's every entity created, destroyed or given another mask, along with its mask, every component attached or modified since, and every singleton
+		// Components are only seen as modified when written through a view or marked with markChanged
+		// Returns false if deltas aren't tracked, archetypes are used, a stored type can't be saved, or entities were renumbered or cleared after the tick
+		bool writeDelta(Serialization::BinaryWriter& writer, const Tick since) const;
+		// Applies a delta onto the state it was written after, such as a restored snapshot followed by each earlier delta, where CompTypes must include every type in it
+		// Components of entities which lost them are detached, and the rest are attached or overwritten. Requires that no groups are registered
+		// Returns false if the delta can't be read or doesn't match the types, which can leave it partly applied
+		template<typename... CompTypes>
+		bool applyDelta(Serialization::BinaryReader& reader)
+		{
+			return applyDeltaFrom(reader, getLoaders<CompTypes...>());
+		}
+
+		// Stamps a component as changed at the current tick, for components modified outside of views, if its type tracks changes
+		template<typename CompType>
+		void markChanged(const EntityID entityID)
+		{
+			static_assert(!is_singleton<CompType>::value, "Singletons aren't tracked");
+			if (ComponentPool<CompType>* pool = getPool<CompType>())
+			{
+				pool->components.markChanged(entityID);
+			}
 		}
 
 	private:
@@ -135,8 +459,9 @@ namespace ECS
 			return (compTypeID < m_componentPools.size() && m_componentPools[compTypeID]);
 		}
 
+		// Creates the pool of a type unless it exists, allocated from the manager's resource unless another one is passed
 		template<typename CompType>
-		void createPool()
+		void createPool(std::pmr::memory_resource* resource = nullptr)
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
 			static constexpr size_t compTypeID = static_cast<const size_t>(getID<CompType>());
@@ -148,31 +473,237 @@ namespace ECS
 			{
 				return;
 			}
-			m_componentPools[compTypeID] = new ComponentPool<CompType>;		// TODO: change allocation method
+			m_componentPools[compTypeID] = ComponentPool<CompType>::create(resource ? resource : m_resource);
+			if (m_tracksDeltas)
+			{
+				m_componentPools[compTypeID]->trackTicks(&m_tick);
+			}
 		}
 
 		template<typename CompType>
-		ComponentPool<CompType>* getPool()
+		ComponentPool<CompType>* getPool() const
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
 			static constexpr ComponentTypeID compTypeID = getID<CompType>();
-			return static_cast<ComponentPool<CompType>*>(m_componentPools[compTypeID]);
+			return (hasPool<CompType>() ? static_cast<ComponentPool<CompType>*>(m_componentPools[compTypeID]) : nullptr);
+		}
+
+		// What a view reads an included type from, see included_storage_t
+		template<typename CompType>
+		included_storage_t<CompType>* getIncluded() const
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				return getSingleton<CompType>();
+			}
+			else
+			{
+				return getPool<CompType>();
+			}
+		}
+
+		// Bulk attachment shared by entity IDs and handles. componentAt(i) returns the component of the i:th entity
+		template<typename CompType, typename Handle, typename ComponentFunc>
+		size_t attachComponentsTo(Span<const Handle> entities, ComponentFunc componentAt)
+		{
+			static_assert(is_component<CompType>::value, "Not a component");
+			static_assert(!is_singleton<CompType>::value, "Singletons can't be attached in bulk");
+
+			if constexpr (!is_singleton<CompType>::value)
+			{
+				if (m_archetypes)
+				{
+					// Every attachment moves the entity to another archetype, which can't be batched
+					size_t attachedCount = 0;
+					for (size_t i = 0; i < entities.size(); i++)
+					{
+						const EntityID entityID = idOf(entities[i]);
+						if (isValid(entities[i]) && !hasComponent<CompType>(entityID))
+						{
+							attachComponent<CompType>(entityID, componentAt(i));
+							attachedCount++;
+						}
+					}
+					return attachedCount;
+				}
+			}
+
+			createPool<CompType>();
+			ComponentPool<CompType>* pool = getPool<CompType>();
+
+			// Filter out and mark the entities in one pass. Marking them makes later duplicates in the input fail the check
+			std::vector<EntityID> attachedIDs;
+			std::vector<size_t> positions;
+			attachedIDs.reserve(entities.size());
+			positions.reserve(entities.size());
+			for (size_t i = 0; i < entities.size(); i++)
+			{
+				const EntityID entityID = idOf(entities[i]);
+				if (isValid(entities[i]) && !hasComponent<CompType>(entityID))
+				{
+					addToBitMask<CompType>(entityID);
+					attachedIDs.push_back(entityID);
+					positions.push_back(i);
+				}
+			}
+
+			pool->components.addMany(attachedIDs, [&componentAt, &positions](const size_t i) { return componentAt(positions[i]); });
+
+			if (pool->group)
+			{
+				for (const EntityID entityID : attachedIDs)
+				{
+					pool->group->onAttach(entityID);
+				}
+			}
+			return attachedIDs.size();
+		}
+		// Batched destruction shared by entity IDs and handles
+		template<typename Handle>
+		void destroyEntitiesOf(Span<const Handle> entities)
+		{
+			// Invalidating the entities right away makes later duplicates in the input fail the check
+			// Their masks are kept until the components are released, as they tell which pools to release them from
+			std::vector<EntityID> destroyedIDs;
+			destroyedIDs.reserve(entities.size());
+			for (const Handle& entity : entities)
+			{
+				if (isValid(entity))
+				{
+					destroyedIDs.push_back(idOf(entity));
+					invalidateEntity(idOf(entity));
+				}
+			}
+
+			releaseComponents(destroyedIDs);
+			for (const EntityID entityID : destroyedIDs)
+			{
+				resetComponentMask(entityID);
+			}
+		}
+		static EntityID idOf(const EntityID entityID) noexcept
+		{
+			return entityID;
+		}
+		static EntityID idOf(const Entity& entity) noexcept
+		{
+			return entity.ID;
+		}
+
+		// The group owning exactly the passed types, if any
+		template<typename FirstType, typename... OtherTypes>
+		const BaseComponentGroup* findGroup() const
+		{
+			// Groups never own singletons
+			if constexpr (is_singleton<FirstType>::value || (is_singleton<OtherTypes>::value || ...))
+			{
+				return nullptr;
+			}
+			else
+			{
+				const ComponentPool<FirstType>* pool = getPool<FirstType>();
+				if (!pool || !pool->group)
+				{
+					return nullptr;
+				}
+
+				constexpr Bitmask mask = calculateMask<FirstType, OtherTypes...>();
+				return (pool->group->getMask() == mask ? pool->group : nullptr);
+			}
 		}
 
 		template<typename CompType>
 		void addToBitMask(EntityID entityID)
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
-			m_componentMasks[entityID] |= (1ULL << getID<CompType>());
+			m_componentMasks[entityID].set(getID<CompType>());
+			touchEntity(entityID);
 		}
 
 		template<typename CompType>
 		void removeFromBitMask(EntityID entityID)
 		{
 			static_assert(is_component<CompType>::value, "Not a component");
-			m_componentMasks[entityID] &= ~(1ULL << getID<CompType>());
+			m_componentMasks[entityID].reset(getID<CompType>());
+			touchEntity(entityID);
+		}
+		// Stamps an entity with the current tick when it's created or destroyed or its mask changes, if deltas are tracked
+		void touchEntity(const EntityID entityID) noexcept
+		{
+			if (m_tracksDeltas)
+			{
+				m_entityTicks[entityID] = m_tick;
+			}
 		}
 
+		// Loads the components of one type stored in a snapshot, or the changed components of one type stored in a delta
+		template<typename CompType, bool IS_DELTA>
+		static bool loadType(ECSManager& manager, Serialization::BinaryReader& reader)
+		{
+			if constexpr (is_singleton<CompType>::value)
+			{
+				manager.destroySingleton(getID<CompType>());
+				if constexpr (Serialization::has_serialization_hooks<CompType>::value)
+				{
+					manager.createSingleton<CompType>(CompType::load(reader));
+				}
+				else
+				{
+					const void* singleton = reader.readBytes(sizeof(CompType), alignof(CompType));
+					if (singleton)
+					{
+						manager.createSingleton<CompType>(*static_cast<const CompType*>(singleton));
+					}
+				}
+				return reader.isGood();
+			}
+			else
+			{
+				manager.createPool<CompType>();
+				SparseSet<CompType>& components = manager.getPool<CompType>()->components;
+				return (IS_DELTA ? components.loadChanges(reader) : components.load(reader));
+			}
+		}
+
+		// How snapshots and deltas load one component type, and the layout the type must have been saved with
+		struct TypeLoader
+		{
+			ComponentTypeID typeID;
+			bool isSingleton;
+			size_t size;
+			size_t alignment;
+			bool (*load)(ECSManager& manager, Serialization::BinaryReader& reader);
+			bool (*loadChanges)(ECSManager& manager, Serialization::BinaryReader& reader);
+		};
+		template<typename... CompTypes>
+		static Span<const TypeLoader> getLoaders()
+		{
+			static_assert((is_component<CompTypes>::value && ...), "Not a component");
+			static_assert(((is_singleton<CompTypes>::value ? Serialization::is_serializable<CompTypes>::value : SparseSet<CompTypes>::IS_SERIALIZABLE) && ...),
+				"Components must be trivially copyable or have serialization hooks");
+
+			static const std::array<TypeLoader, sizeof...(CompTypes)> s_loaders =
+			{
+				TypeLoader{ getID<CompTypes>(), is_singleton<CompTypes>::value, sizeof(CompTypes), alignof(CompTypes), &loadType<CompTypes, false>, &loadType<CompTypes, true> }...
+			};
+			return s_loaders;
+		}
+		bool restoreFrom(const std::string& path, Span<const TypeLoader> loaders);
+		bool restoreFrom(Serialization::BinaryReader& reader, Span<const TypeLoader> loaders);
+		bool applyDeltaFrom(Serialization::BinaryReader& reader, Span<const TypeLoader> loaders);
+		// Writes the layout and contents of every pool and singleton, or only the components changed after the tick if there is one
+		void saveTypes(Serialization::BinaryWriter& writer, const Tick* since) const;
+		// Loads what saveTypes wrote, with each type's load or loadChanges
+		bool loadTypes(Serialization::BinaryReader& reader, const std::uint32_t typeCount, Span<const TypeLoader> loaders, const bool isDelta);
+		// Counts the pools and singletons. Returns false if any of them can't be saved
+		bool countSaveableTypes(std::uint32_t& typeCount) const noexcept;
+
+		void destroySingleton(const ComponentTypeID compTypeID) noexcept;
+
+		// Removes every component of the entities from their pools or archetypes. The masks are left as they were
+		void releaseComponents(Span<const EntityID> entityIDs);
+		void releaseFromPool(const ComponentTypeID compTypeID, Span<const EntityID> entityIDs);
+
 		bool hasInvalidEntities() const noexcept;
 		EntityID getAndPopLastInvalidEntityID();
 		EntityID createNewEntity();
@@ -181,16 +712,64 @@ namespace ECS
 		void invalidateEntity(const EntityID entityID);
 
 	private:
+		/*
+			Every created entity has a slot.
+			The slot of a valid entity links to the entity itself,
+			while the slot of an invalid entity links to the next invalid entity, forming a list of reusable IDs.
+		*/
+		struct EntitySlot
+		{
+			EntityID next;
+			EntityGeneration generation;
+		};
+
+		// A singleton and how to destroy and save it, which is only known by its type
+		struct SingletonSlot
+		{
+			void* object = nullptr;
+			void (*destroy)(void* object, std::pmr::memory_resource* resource) = nullptr;
+
+			// Null if the type can't be saved
+			void (*save)(const void* object, Serialization::BinaryWriter& writer) = nullptr;
+			size_t size = 0;
+			size_t alignment = 0;
+		};
+
+	private:
+		// Resource which entities, pools and their components are allocated from
+		std::pmr::memory_resource* m_resource;
+
 		// Bitwise representation of which components each entity has
-		std::vector<Bitmask> m_componentMasks;
+		std::pmr::vector<Bitmask> m_componentMasks;
 
-		// Validity of each entity
-		std::vector<bool> m_isValidEntity;
+		// Validity, generation and free list link of each entity
+		std::pmr::vector<EntitySlot> m_entitySlots;
 
 		// Pools where components are stored
-		std::vector<BaseComponentPool*> m_componentPools;
+		std::pmr::vector<BaseComponentPool*> m_componentPools;
+
+		// Singletons indexed by type ID, with room for every type so that reaching one is a single load
+		std::array<SingletonSlot, MAX_COMPONENT_TYPES> m_singletons{};
+
+		// Groups owning some of the pools
+		std::vector<std::unique_ptr<BaseComponentGroup>> m_groups;
+
+		// Most recently invalidated entity ID, which is the head of the free list in m_entitySlots
+		EntityID m_lastInvalidEntityID = NULL_ENTITY_ID;
+
+		// Type ID of the next pool for sortPools to sort
+		size_t m_nextPoolToSort = 0;
+
+		// Tick which components are currently stamped with. Starts above zero, which filters use to let everything through
+		Tick m_tick = 1;
+
+		// Tick of each entity's last structural change while deltas are tracked, otherwise empty
+		std::pmr::vector<Tick> m_entityTicks;
+		bool m_tracksDeltas = false;
+		// Tick at which the entities were last renumbered or cleared, which deltas can't be written across
+		Tick m_renumberTick = 0;
 
-		// Previously created, but later invalidated, entity IDs
-		std::vector<EntityID> m_invalidEntityIDs;
+		// Storage of non-singleton components when using StorageMode::Archetype, otherwise null
+		std::unique_ptr<ArchetypeStorage> m_archetypes;
 	};
 }
\ No newline at end of file
@@ -22,4 +22,28 @@ namespace ECS
 	// Evaluates to true if type T is singleton
 	template<typename T>
 	struct is_singleton<T, std::void_t<decltype(T::IS_SINGLETON)>> : public std::true_type {};
+
+	/******************************
+	** Function parameter checks **
+	******************************/
+
+	// Default evaluates to false
+	template<typename Parameter, typename CompType, typename Attempt = void>
+	struct is_read_only_parameter_of_soa : public std::false_type {};
+
+	// Evaluates to true if the parameter is the read-only reference of a structure-of-arrays type
+	template<typename Parameter, typename CompType>
+	struct is_read_only_parameter_of_soa<Parameter, CompType, std::void_t<typename CompType::SoAConstRef>> :
+		public std::is_same<std::decay_t<Parameter>, typename CompType::SoAConstRef> {};
+
+	// Evaluates to true if a function parameter can't be used to modify the component it's passed
+	// That's a const reference, a copy of the component, or a SoAConstRef
+	template<typename Parameter, typename CompType>
+	struct is_read_only_parameter
+	{
+		static constexpr bool value =
+			std::is_const_v<std::remove_reference_t<Parameter>> ||
+			(!std::is_reference_v<Parameter> && std::is_same_v<Parameter, CompType>) ||
+			is_read_only_parameter_of_soa<Parameter, CompType>::value;
+	};
 }
\ No newline at end of file
@@ -1,20 +1,40 @@
 #pragma once
+#include <cstdint>
 
 namespace ECS
 {
 	class ECSManager;
+	class CommandBuffer;
 
 	using EntityID = int;
+	using EntityGeneration = std::uint32_t;
 
+	static constexpr EntityID NULL_ENTITY_ID = -1;
+
+	/*
+		Handle to an entity.
+		The ID is the index of the entity and is reused after the entity is destroyed,
+		while the generation is increased on every destruction.
+		A handle is therefore only valid as long as its generation matches the one stored by the manager,
+		meaning that it's safe to keep handles to other entities, such as in components.
+
+		A default constructed handle is never valid.
+	*/
 	struct Entity final
 	{
+		Entity() = default;
 		Entity(const Entity& other) = default;
 		~Entity() = default;
+		Entity& operator=(const Entity& other) = default;
 
-		const EntityID ID;
+		bool operator==(const Entity& other) const noexcept { return ID == other.ID && generation == other.generation; }
+		bool operator!=(const Entity& other) const noexcept { return !(*this == other); }
+
+		EntityID ID = NULL_ENTITY_ID;
+		EntityGeneration generation = 0;
 	private:
 		friend class ECSManager;
-		Entity() = default;
-		Entity(const EntityID _ID) : ID(_ID) {}
+		friend class CommandBuffer;
+		Entity(const EntityID _ID, const EntityGeneration _generation) : ID(_ID), generation(_generation) {}
 	};
-}
\ No newline at end of file
+}
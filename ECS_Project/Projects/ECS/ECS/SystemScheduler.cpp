@@ -0,0 +1,153 @@
+#include "pch_ECS.hpp"
+#include "SystemScheduler.hpp"
+#include <algorithm>
+
+namespace ECS
+{
+	SystemScheduler::SystemScheduler(ECSManager& manager, Threading::ThreadPool& threadPool) :
+		m_manager(manager), m_threadPool(threadPool)
+	{
+	}
+
+	void SystemScheduler::setName(const size_t system, const std::string& name)
+	{
+		m_systems[system].label = Timer::intern(name);
+	}
+
+	void SystemScheduler::run(const float dt)
+	{
+		if (!m_isGraphBuilt)
+		{
+			buildGraph();
+		}
+
+		for (size_t i = 0; i < m_systems.size(); i++)
+		{
+			m_pendingPredecessors[i].store(m_systems[i].predecessorCount, std::memory_order_relaxed);
+		}
+
+		// Running a single system directly avoids waking any worker
+		if (m_roots.size() == 1)
+		{
+			runFrom(m_roots.front(), dt);
+			return;
+		}
+
+		m_threadPool.parallelFor(m_roots.size(), 1, [this, dt](const size_t begin, const size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					runFrom(m_roots[i], dt);
+				}
+			}
+		);
+	}
+
+	size_t SystemScheduler::longestChain()
+	{
+		if (!m_isGraphBuilt)
+		{
+			buildGraph();
+		}
+
+		// Successors always come after their predecessors, so each chain is complete when its system is reached
+		std::vector<size_t> chainOfSystem(m_systems.size(), 1);
+		size_t longest = 0;
+		for (size_t i = 0; i < m_systems.size(); i++)
+		{
+			for (const size_t successor : m_systems[i].successors)
+			{
+				chainOfSystem[successor] = std::max(chainOfSystem[successor], chainOfSystem[i] + 1);
+			}
+			longest = std::max(longest, chainOfSystem[i]);
+		}
+		return longest;
+	}
+
+	size_t SystemScheduler::add(const Bitmask reads, const Bitmask writes, SystemFunction function)
+	{
+		const size_t system = m_systems.size();
+		m_systems.push_back({ reads | writes, writes, std::move(function), Timer::intern("System " + std::to_string(system)), {}, 0 });
+		m_isGraphBuilt = false;
+		return system;
+	}
+
+	void SystemScheduler::runSystem(const System& system, const float dt)
+	{
+		const Timer::Scoped scope(system.label);
+		const Timer::CountedScope counted(system.label);
+		system.function(m_manager, dt);
+	}
+
+	void SystemScheduler::runFrom(size_t system, const float dt)
+	{
+		std::vector<size_t> ready;
+		while (true)
+		{
+			runSystem(m_systems[system], dt);
+
+			ready.clear();
+			for (const size_t successor : m_systems[system].successors)
+			{
+				if (m_pendingPredecessors[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					ready.push_back(successor);
+				}
+			}
+
+			// A single successor continues on this thread, while several are handed to the pool
+			if (ready.empty())
+			{
+				return;
+			}
+			if (ready.size() == 1)
+			{
+				system = ready.front();
+				continue;
+			}
+
+			m_threadPool.parallelFor(ready.size(), 1, [this, &ready, dt](const size_t begin, const size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+					{
+						runFrom(ready[i], dt);
+					}
+				}
+			);
+			return;
+		}
+	}
+
+	void SystemScheduler::buildGraph()
+	{
+		m_roots.clear();
+		for (size_t i = 0; i < m_systems.size(); i++)
+		{
+			// Systems are only ever ordered after earlier systems, meaning that the dependencies can't form a cycle
+			System& system = m_systems[i];
+			system.successors.clear();
+			system.predecessorCount = 0;
+			for (size_t earlier = 0; earlier < i; earlier++)
+			{
+				if (conflicts(m_systems[earlier], system))
+				{
+					m_systems[earlier].successors.push_back(i);
+					system.predecessorCount++;
+				}
+			}
+
+			if (system.predecessorCount == 0)
+			{
+				m_roots.push_back(i);
+			}
+		}
+
+		m_pendingPredecessors = std::make_unique<std::atomic<size_t>[]>(m_systems.size());
+		m_isGraphBuilt = true;
+	}
+
+	bool SystemScheduler::conflicts(const System& first, const System& second) noexcept
+	{
+		return first.writes.intersects(second.reads) || first.reads.intersects(second.writes);
+	}
+}
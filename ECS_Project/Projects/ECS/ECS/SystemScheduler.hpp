@@ -0,0 +1,139 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "ECSManager.hpp"
+#include "Utilities/HelperTemplates.hpp"
+#include "Utilities/PerfCounters.hpp"
+#include "Utilities/Threading/ThreadPool.hpp"
+
+namespace ECS
+{
+	// Component types which a system declares that it reads from or writes to
+	template<typename... T> struct Reads {};
+	template<typename... T> struct Writes {};
+
+	/*
+		Runs systems once per frame, with systems which don't conflict running at the same time on a thread pool.
+
+		Each system declares which component types it reads and writes. Two systems conflict if either writes a type
+		the other one accesses, in which case the one added first runs first. Each system waits only for the systems it conflicts with,
+		and is started on the thread pool as soon as the last of them finishes, regardless of any other system still running.
+
+		Systems must not create or destroy entities, or attach or detach components, while the scheduler runs.
+		Each run of a system is timed as a Timer scope, named "System" followed by its index unless it's given a name.
+		While Timer counters are enabled, its hardware events are counted per entity visited by the views it iterates on the calling thread.
+	*/
+	class SystemScheduler final
+	{
+	public:
+		using SystemFunction = std::function<void(ECSManager&, float)>;
+
+		explicit SystemScheduler(ECSManager& manager, Threading::ThreadPool& threadPool = Threading::ThreadPool::getDefault());
+		SystemScheduler(const SystemScheduler& other) = delete;
+		~SystemScheduler() = default;
+		SystemScheduler& operator=(const SystemScheduler& other) = delete;
+
+		// Adds a system which calls the passed function on each entity of the view of the included and excluded types
+		// The function is sent the frame time, followed by the included components like in ComponentView::for_each_entity
+		// Components are read-only if their parameters are const references, copies or SoAConstRef, and are written otherwise
+		// Returns the index of the system
+		template<typename... IncludedTypes, typename Function, typename... ExcludedTypes>
+		size_t addSystem(Function f, TypeList<ExcludedTypes...> excluded = {})
+		{
+			using Arguments = function_arguments_t<Function>;
+			static_assert(std::tuple_size_v<Arguments> == sizeof...(IncludedTypes) + 1, "System functions take the frame time followed by each included component");
+
+			constexpr Bitmask writes = writtenTypes<Arguments, IncludedTypes...>(std::index_sequence_for<IncludedTypes...>());
+			constexpr Bitmask reads = calculateMask<IncludedTypes..., ExcludedTypes...>();
+
+			return add(reads, writes, [f, excluded](ECSManager& manager, const float dt) mutable
+				{
+					manager.getView<IncludedTypes...>(excluded).for_each_entity(makeCall<Arguments>(f, dt, std::index_sequence_for<IncludedTypes...>()));
+				}
+			);
+		}
+
+		// Adds a system which is a function of the manager and frame time, and accesses the declared types
+		template<typename... ReadTypes, typename... WrittenTypes>
+		size_t addSystem(Reads<ReadTypes...>, Writes<WrittenTypes...>, SystemFunction function)
+		{
+			return add(calculateMask<ReadTypes..., WrittenTypes...>(), calculateMask<WrittenTypes...>(), std::move(function));
+		}
+
+		// Names the Timer scope of a system
+		void setName(const size_t system, const std::string& name);
+
+		// Runs every system once
+		void run(const float dt);
+
+		// Number of systems in the longest chain of systems which must run one after another
+		[[nodiscard]] size_t longestChain();
+
+	private:
+		struct System
+		{
+			Bitmask reads;
+			Bitmask writes;
+			SystemFunction function;
+			Timer::Label label;
+
+			// Later systems which conflict with this one, and the number of earlier ones it waits for
+			std::vector<size_t> successors;
+			size_t predecessorCount;
+		};
+
+		// Calls a system function with the frame time and the components
+		// The component parameters keep the types of the system function, which lets views know which components are written
+		template<typename Function, typename... Parameters>
+		struct SystemCall
+		{
+			Function& function;
+			float dt;
+
+			void operator()(Parameters... components) const
+			{
+				function(dt, std::forward<Parameters>(components)...);
+			}
+		};
+		template<typename Arguments, typename Function, size_t... I>
+		static SystemCall<Function, std::tuple_element_t<I + 1, Arguments>...> makeCall(Function& function, const float dt, std::index_sequence<I...>)
+		{
+			return { function, dt };
+		}
+
+		template<typename Arguments, typename... IncludedTypes, size_t... I>
+		static constexpr Bitmask writtenTypes(std::index_sequence<I...>)
+		{
+			// The first argument is the frame time
+			return ((is_read_only_parameter<std::tuple_element_t<I + 1, Arguments>, IncludedTypes>::value ? ComponentMask() : ComponentMask::of(IncludedTypes::TYPE_ID)) | ... | ComponentMask());
+		}
+
+		size_t add(const Bitmask reads, const Bitmask writes, SystemFunction function);
+
+		// Runs a system as a Timer scope, and a counted scope
+		void runSystem(const System& system, const float dt);
+
+		// Runs a system whose predecessors are done, followed by each successor it was the last predecessor of
+		void runFrom(size_t system, const float dt);
+
+		// Orders each system after every earlier one it conflicts with
+		void buildGraph();
+
+		static bool conflicts(const System& first, const System& second) noexcept;
+
+	private:
+		ECSManager& m_manager;
+		Threading::ThreadPool& m_threadPool;
+
+		std::vector<System> m_systems;
+
+		// Systems without predecessors, rebuilt along with the successors when a system is added
+		std::vector<size_t> m_roots;
+		bool m_isGraphBuilt = true;
+
+		// Predecessors of each system which haven't finished during the current run
+		std::unique_ptr<std::atomic<size_t>[]> m_pendingPredecessors;
+	};
+}
@@ -11,10 +11,17 @@
 
 // add headers that you want to pre-compile here
 
+#include "Archetypes/Archetype.hpp"
+#include "Archetypes/ArchetypeStorage.hpp"
+#include "Archetypes/ComponentInfo.hpp"
+#include "CommandBuffer.hpp"
 #include "Components/Component.hpp"
+#include "Components/ComponentGroup.hpp"
+#include "Components/ComponentMask.hpp"
 #include "Components/ComponentPool.hpp"
 #include "Components/ComponentView.hpp"
 #include "ECSManager.hpp"
 #include "Entity.h"
+#include "SystemScheduler.hpp"
 
 #endif //PCH_ECS_HPP
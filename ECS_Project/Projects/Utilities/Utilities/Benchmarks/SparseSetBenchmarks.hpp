@@ -47,28 +47,28 @@ public:
 		GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
 		m_results.initialWindowsSize = pmc.WorkingSetSize;
 
-		m_results.initialSize = m_sparseSet.getByteSize();
+		m_results.initialSize = m_sparseSet.byteSize();
 
 		m_results.creationTime = create(N_ELEMS);
-		m_results.creationSize = m_sparseSet.getByteSize();
+		m_results.creationSize = m_sparseSet.byteSize();
 
 		m_results.removalTime = destroyFirst(N_ELEMS);
-		m_results.removalSize = m_sparseSet.getByteSize();
+		m_results.removalSize = m_sparseSet.byteSize();
 
 		m_results.recreationTime = create(N_ELEMS);
-		m_results.recreationSize = m_sparseSet.getByteSize();
+		m_results.recreationSize = m_sparseSet.byteSize();
 
 		m_results.halfRemovalTime = destroyFirst(N_ELEMS / 2);
-		m_results.halfRemovalSize = m_sparseSet.getByteSize();
+		m_results.halfRemovalSize = m_sparseSet.byteSize();
 
 		m_results.halfCreationTime = create(N_ELEMS / 2);
-		m_results.halfCreationSize = m_sparseSet.getByteSize();
+		m_results.halfCreationSize = m_sparseSet.byteSize();
 
 		m_results.checkTime = check(N_ELEMS);
-		m_results.checkSize = m_sparseSet.getByteSize();
+		m_results.checkSize = m_sparseSet.byteSize();
 
 		m_results.getTime = get(N_ELEMS);
-		m_results.getSize = m_sparseSet.getByteSize();
+		m_results.getSize = m_sparseSet.byteSize();
 
 		GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
 		m_results.totalWindowsSize = pmc.WorkingSetSize;
@@ -91,7 +91,7 @@ public:
 	}
 	size_t getSparseSetByteSize() const
 	{
-		return m_sparseSet.getByteSize();
+		return m_sparseSet.byteSize();
 	}
 
 private:
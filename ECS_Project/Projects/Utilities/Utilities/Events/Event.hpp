@@ -8,10 +8,10 @@ namespace Events
 
 		NOTE:
 
-		Event type IDs will assign automatically when calling type() for the first time.
-		If a certain type never calls type(), the assign will never happen.
-		This means that nrOfEventTypes() will return the number of types actually in use,
-		not the number of declared types.
+		Event type IDs are assigned during static initialization, once for every event type which is used with an EventManager.
+		Reading an ID is a plain load, without the guard of a function-local static.
+		Events must therefore not be subscribed to or emitted from other static initializers, as the ID might not be assigned yet.
+		nrOfEventTypes() returns the number of types actually in use, not the number of declared types.
 
 	*/
 
@@ -19,11 +19,11 @@ namespace Events
 	/*
 		Do not inherit directly from BaseEvent
 		See Event below
+
+		Like components, events have no virtual functions and must not be deleted through a pointer to the base.
 	*/
 	struct BaseEvent
 	{
-		virtual ~BaseEvent() = default;
-
 		static EventTypeID nrOfEventTypes()
 		{
 			return s_event_ID_counter;
@@ -42,15 +42,15 @@ namespace Events
 	template<typename T>
 	struct Event : public BaseEvent
 	{
-		virtual ~Event() = default;
+		// This type's identifier ID
+		inline static const EventTypeID TYPE_ID = s_event_ID_counter++;
 
 		// Returns this type's identifier ID
 		static EventTypeID typeID()
 		{
-			static EventTypeID ID = s_event_ID_counter++;
-			return ID;
+			return TYPE_ID;
 		}
 	protected:
 		Event() = default;
 	};
-}
\ No newline at end of file
+}
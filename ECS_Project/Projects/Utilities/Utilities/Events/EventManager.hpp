@@ -1,41 +1,327 @@
 #pragma once
-#include <vector>
+#include <algorithm>
+#include <memory>
 #include <type_traits>
+#include <vector>
 #include "Event.hpp"
-#include "EventReceiver.hpp"
+#include "EventQueue.hpp"
 
 namespace Events
 {
-	template<typename ReceiverType>
-	using enable_if_receiver = std::enable_if_t<std::is_base_of<EventReceiver<ReceiverType>, ReceiverType>::value, void>;
+	template<typename EventType>
+	using enable_if_event = std::enable_if_t<std::is_base_of<Event<EventType>, EventType>::value, void>;
+
+	/*
+		Dispatches events to the functions subscribed to their type.
+
+		Every event type has a contiguous array of delegates, indexed by the type's ID.
+		A delegate is an object pointer and a function pointer to a thunk which calls the bound function directly,
+		so emitting an event costs one indirect call per receiver, without virtual functions or std::function.
 
+		Receivers are bound at compile time, i.e. like
+			events.subscribe<SpawnCharacter>(receiver);					// Calls receiver.receive(const SpawnCharacter&)
+			events.subscribe<SpawnCharacter, &Receiver::onSpawn>(receiver);	// Calls receiver.onSpawn(const SpawnCharacter&)
+			events.subscribe<SpawnCharacter, &onSpawn>();					// Calls onSpawn(const SpawnCharacter&)
+		and are unsubscribed with the same arguments, or all at once with unsubscribeAll(receiver).
+
+		Receivers may subscribe to and unsubscribe from any event type while an event is emitted, including the type being emitted.
+		Receivers subscribed during emit() don't receive the current event.
+		Receivers unsubscribed during emit() are replaced by an empty delegate, and removed when the outermost emit() of the type returns,
+		which keeps the delegate array from being reallocated or shifted while it is iterated.
+
+		Events can also be queued from any thread with enqueue(), which appends them to the type's EventQueue.
+		swapQueues() is called once per frame at a sync point, after which the queued events are read in bulk
+		as a span through queued(), or dispatched to the subscribers by emitQueued().
+
+		Only enqueue() is thread safe, and only for event types whose queue has been created with getQueue().
+	*/
 	class EventManager final
 	{
 	public:
 		EventManager() = default;
 		~EventManager() = default;
+		EventManager(const EventManager& other) = delete;
+		EventManager& operator=(const EventManager& other) = delete;
+
+		// Subscribes receiver.receive(const EventType&)
+		template<typename EventType, typename ReceiverType>
+		enable_if_event<EventType> subscribe(ReceiverType& receiver)
+		{
+			addDelegate(EventType::TYPE_ID, { &receiver, &receiveThunk<EventType, ReceiverType> });
+		}
+
+		// Subscribes (receiver.*Function)(const EventType&)
+		template<typename EventType, auto Function, typename ReceiverType>
+		enable_if_event<EventType> subscribe(ReceiverType& receiver)
+		{
+			addDelegate(EventType::TYPE_ID, { &receiver, &memberThunk<EventType, Function, ReceiverType> });
+		}
+
+		// Subscribes Function(const EventType&)
+		template<typename EventType, auto Function>
+		enable_if_event<EventType> subscribe()
+		{
+			addDelegate(EventType::TYPE_ID, { nullptr, &functionThunk<EventType, Function> });
+		}
 
 		template<typename EventType, typename ReceiverType>
-		enable_if_receiver<ReceiverType> subscribe(ReceiverType& receiver)
+		enable_if_event<EventType> unsubscribe(ReceiverType& receiver)
+		{
+			removeDelegate(EventType::TYPE_ID, { &receiver, &receiveThunk<EventType, ReceiverType> });
+		}
+
+		template<typename EventType, auto Function, typename ReceiverType>
+		enable_if_event<EventType> unsubscribe(ReceiverType& receiver)
+		{
+			removeDelegate(EventType::TYPE_ID, { &receiver, &memberThunk<EventType, Function, ReceiverType> });
+		}
+
+		template<typename EventType, auto Function>
+		enable_if_event<EventType> unsubscribe()
+		{
+			removeDelegate(EventType::TYPE_ID, { nullptr, &functionThunk<EventType, Function> });
+		}
+
+		// Unsubscribes every function bound to the receiver, from every event type
+		template<typename ReceiverType>
+		void unsubscribeAll(ReceiverType& receiver)
+		{
+			for (EventTypeID typeID = 0; typeID < static_cast<EventTypeID>(m_channels.size()); typeID++)
+			{
+				removeObject(typeID, &receiver);
+			}
+		}
+
+		template<typename EventType>
+		enable_if_event<EventType> emit(const EventType& e)
 		{
-			if (EventType::ID >= m_receivers.size())
+			const EventTypeID typeID = EventType::TYPE_ID;
+			if (typeID >= m_channels.size())
 			{
-				m_receivers.resize(EventType::ID + 1);
+				return;
 			}
-			void (ReceiverType::*receive)(const EventType&) = &ReceiverType::receive;
+
+			// Receivers subscribed during the loop are appended past the end, so they are skipped
+			const size_t count = m_channels[typeID].delegates.size();
+			const EmitScope scope(*this, typeID);
+			for (size_t i = 0; i < count; i++)
+			{
+				// Looked up every iteration, as a nested subscribe() may have reallocated the delegates or the channels
+				const Delegate& delegate = m_channels[typeID].delegates[i];
+				delegate.function(delegate.object, &e);
+			}
+		}
+
+		// Returns the number of receivers subscribed to the event type
+		template<typename EventType>
+		size_t nrOfReceivers() const
+		{
+			const EventTypeID typeID = EventType::TYPE_ID;
+			if (typeID >= m_channels.size())
+			{
+				return 0;
+			}
+
+			const std::vector<Delegate>& delegates = m_channels[typeID].delegates;
+			return static_cast<size_t>(std::count_if(delegates.begin(), delegates.end(), [](const Delegate& delegate) { return !delegate.isRemoved(); }));
+		}
+
+		// Creates the queue of the event type if needed
+		// Not thread safe, so queues should be created before any thread enqueues events of the type
+		template<typename EventType>
+		EventQueue<EventType>& getQueue()
+		{
+			const EventTypeID typeID = EventType::TYPE_ID;
+			if (typeID >= m_queues.size())
+			{
+				m_queues.resize(typeID + 1);
+			}
+			if (!m_queues[typeID])
+			{
+				m_queues[typeID] = std::make_unique<EventQueue<EventType>>();
+			}
+			return static_cast<EventQueue<EventType>&>(*m_queues[typeID]);
+		}
+
+		// Queues the event until the next swapQueues(), and can be called from any thread
+		// Events of types without a queue are dropped
+		template<typename EventType>
+		enable_if_event<EventType> enqueue(EventType e)
+		{
+			if (EventQueue<EventType>* queue = findQueue<EventType>())
+			{
+				queue->push(std::move(e));
+			}
+		}
+
+		// Makes the events enqueued since the last call available, replacing the previous ones
+		// Must not be called while other threads enqueue events
+		void swapQueues()
+		{
+			for (const std::unique_ptr<BaseEventQueue>& queue : m_queues)
+			{
+				if (queue)
+				{
+					queue->swap();
+				}
+			}
+		}
+
+		// Events which were enqueued before the last swapQueues()
+		template<typename EventType>
+		Span<const EventType> queued() const
+		{
+			const EventQueue<EventType>* queue = findQueue<EventType>();
+			return (queue ? queue->events() : Span<const EventType>());
 		}
 
+		// Emits every event which was enqueued before the last swapQueues()
 		template<typename EventType>
-		void emit(const EventType& e)
+		enable_if_event<EventType> emitQueued()
+		{
+			for (const EventType& e : queued<EventType>())
+			{
+				emit(e);
+			}
+		}
+
+	private:
+		using Thunk = void (*)(void* object, const void* e);
+
+		struct Delegate
+		{
+			void* object;
+			Thunk function;
+
+			bool operator==(const Delegate& other) const noexcept
+			{
+				return (object == other.object && function == other.function);
+			}
+
+			// Identified by the object rather than the function, as identical functions may share an address
+			bool isRemoved() const noexcept
+			{
+				return (object == &s_removed);
+			}
+		};
+
+		struct Channel
+		{
+			std::vector<Delegate> delegates;
+			unsigned int emitDepth = 0;
+			bool hasRemoved = false;
+		};
+
+		// Marks a channel as emitting for as long as it lives, which also ends the emit if a receiver throws
+		// The channel is looked up by ID at both ends, as the channels may be reallocated in between
+		struct EmitScope
 		{
-			const auto& receivers = m_receivers[EventType::ID];
-			for (auto r : receivers)
+			EmitScope(EventManager& manager, const EventTypeID typeID) noexcept : manager(manager), typeID(typeID)
+			{
+				manager.m_channels[typeID].emitDepth++;
+			}
+			EmitScope(const EmitScope& other) = delete;
+			~EmitScope()
 			{
-				r->receive(e);
+				Channel& channel = manager.m_channels[typeID];
+				channel.emitDepth--;
+				if (channel.hasRemoved && channel.emitDepth == 0)
+				{
+					compact(channel);
+				}
 			}
+			EmitScope& operator=(const EmitScope& other) = delete;
+
+			EventManager& manager;
+			EventTypeID typeID;
+		};
+
+		template<typename EventType, typename ReceiverType>
+		static void receiveThunk(void* object, const void* e)
+		{
+			static_cast<ReceiverType*>(object)->receive(*static_cast<const EventType*>(e));
+		}
+
+		template<typename EventType, auto Function, typename ReceiverType>
+		static void memberThunk(void* object, const void* e)
+		{
+			(static_cast<ReceiverType*>(object)->*Function)(*static_cast<const EventType*>(e));
+		}
+
+		template<typename EventType, auto Function>
+		static void functionThunk(void*, const void* e)
+		{
+			Function(*static_cast<const EventType*>(e));
+		}
+
+		// Stands in for removed delegates until the channel is compacted
+		static void emptyThunk(void*, const void*)
+		{
+		}
+		inline static char s_removed = 0;
+
+		void addDelegate(const EventTypeID typeID, const Delegate& delegate)
+		{
+			if (typeID >= m_channels.size())
+			{
+				m_channels.resize(typeID + 1);
+			}
+			m_channels[typeID].delegates.push_back(delegate);
+		}
+
+		void removeDelegate(const EventTypeID typeID, const Delegate& delegate)
+		{
+			removeIf(typeID, [&delegate](const Delegate& other) { return other == delegate; });
+		}
+
+		void removeObject(const EventTypeID typeID, const void* object)
+		{
+			removeIf(typeID, [object](const Delegate& other) { return other.object == object; });
+		}
+
+		template<typename Predicate>
+		void removeIf(const EventTypeID typeID, Predicate predicate)
+		{
+			if (typeID >= m_channels.size())
+			{
+				return;
+			}
+
+			Channel& channel = m_channels[typeID];
+			if (channel.emitDepth == 0)
+			{
+				std::vector<Delegate>& delegates = channel.delegates;
+				delegates.erase(std::remove_if(delegates.begin(), delegates.end(), predicate), delegates.end());
+				return;
+			}
+
+			// Keep the array in place while it is iterated, the empty delegates are removed by emit()
+			for (Delegate& delegate : channel.delegates)
+			{
+				if (predicate(delegate))
+				{
+					delegate = { &s_removed, &emptyThunk };
+					channel.hasRemoved = true;
+				}
+			}
+		}
+
+		static void compact(Channel& channel) noexcept
+		{
+			std::vector<Delegate>& delegates = channel.delegates;
+			delegates.erase(std::remove_if(delegates.begin(), delegates.end(), [](const Delegate& delegate) { return delegate.isRemoved(); }), delegates.end());
+			channel.hasRemoved = false;
+		}
+
+		template<typename EventType>
+		EventQueue<EventType>* findQueue() const
+		{
+			const EventTypeID typeID = EventType::TYPE_ID;
+			return (typeID < m_queues.size() ? static_cast<EventQueue<EventType>*>(m_queues[typeID].get()) : nullptr);
 		}
 
 	private:
-		std::vector<std::vector<BaseEventReceiver*>> m_receivers;
+		std::vector<Channel> m_channels;
+		std::vector<std::unique_ptr<BaseEventQueue>> m_queues;
 	};
-}
\ No newline at end of file
+}
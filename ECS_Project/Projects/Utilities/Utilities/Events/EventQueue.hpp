@@ -0,0 +1,124 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "../Span.hpp"
+#include "../Threading/ThreadSlot.hpp"
+#include "Event.hpp"
+
+namespace Events
+{
+	using Threading::MAX_THREAD_SLOTS;
+	using Threading::currentThreadSlot;
+
+	/*
+		Do not inherit directly from BaseEventQueue
+		See EventQueue below
+	*/
+	class BaseEventQueue
+	{
+	public:
+		virtual ~BaseEventQueue() = default;
+
+		// Makes the events pushed since the last swap available through events()
+		virtual void swap() = 0;
+
+	protected:
+		BaseEventQueue() = default;
+	};
+
+	/*
+		Double buffered queue of events, which any number of threads can push to at the same time.
+
+		Every thread appends to its own buffer, so pushing needs neither locks nor atomics, and events are stored by value.
+		swap() merges the buffers into one contiguous array at a sync point, where it can be read as a span until the next swap().
+		Events pushed in the meantime are kept in the thread buffers, which keep their capacity between frames.
+
+		swap() must not be called while other threads push.
+	*/
+	template<typename EventType>
+	class EventQueue final : public BaseEventQueue
+	{
+	public:
+		EventQueue() : m_buffers(std::make_unique<ThreadBuffer[]>(MAX_THREAD_SLOTS))
+		{
+		}
+		~EventQueue() override = default;
+		EventQueue(const EventQueue& other) = delete;
+		EventQueue& operator=(const EventQueue& other) = delete;
+
+		void push(EventType e)
+		{
+			const size_t slot = currentThreadSlot();
+			if (slot < MAX_THREAD_SLOTS)
+			{
+				m_buffers[slot].events.push_back(std::move(e));
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock(m_overflowMutex);
+			m_overflow.push_back(std::move(e));
+		}
+
+		void swap() override
+		{
+			size_t count = m_overflow.size();
+			size_t filledCount = (m_overflow.empty() ? 0 : 1);
+			std::vector<EventType>* filled = &m_overflow;
+			for (size_t slot = 0; slot < MAX_THREAD_SLOTS; slot++)
+			{
+				std::vector<EventType>& events = m_buffers[slot].events;
+				if (!events.empty())
+				{
+					count += events.size();
+					filledCount++;
+					filled = &events;
+				}
+			}
+
+			m_front.clear();
+			if (filledCount == 1)
+			{
+				// A single producer hands over its buffer, and takes the old front buffer to fill next
+				std::swap(m_front, *filled);
+				return;
+			}
+
+			m_front.reserve(count);
+			moveInto(m_overflow);
+			for (size_t slot = 0; slot < MAX_THREAD_SLOTS; slot++)
+			{
+				moveInto(m_buffers[slot].events);
+			}
+		}
+
+		// Events which were pushed before the last swap, ordered by thread slot and then by push order
+		[[nodiscard]] Span<const EventType> events() const noexcept
+		{
+			return Span<const EventType>(m_front.data(), m_front.size());
+		}
+
+	private:
+		// Aligned to keep the buffers of different threads from sharing a cache line
+		struct alignas(64) ThreadBuffer
+		{
+			std::vector<EventType> events;
+		};
+
+		void moveInto(std::vector<EventType>& events)
+		{
+			m_front.insert(m_front.end(), std::make_move_iterator(events.begin()), std::make_move_iterator(events.end()));
+			events.clear();
+		}
+
+	private:
+		std::unique_ptr<ThreadBuffer[]> m_buffers;
+
+		// Used by threads without a slot
+		std::vector<EventType> m_overflow;
+		std::mutex m_overflowMutex;
+
+		std::vector<EventType> m_front;
+	};
+}
@@ -1,22 +0,0 @@
-#pragma once
-
-namespace Events
-{
-	class BaseEventReceiver
-	{
-	public:
-		virtual ~BaseEventReceiver() = default;
-	protected:
-		BaseEventReceiver() = default;
-	};
-
-
-	template<typename T>
-	class EventReceiver : public BaseEventReceiver
-	{
-	public:
-		virtual ~EventReceiver() = default;
-	protected:
-		EventReceiver() = default;
-	};
-}
\ No newline at end of file
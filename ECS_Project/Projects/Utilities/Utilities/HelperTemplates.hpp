@@ -63,4 +63,37 @@ using enable_if_any_of_t = typename enable_if_any_of<T, Ts...>::type;
 
 // Maps an int to a type
 template<int index, typename... Types>
-struct int_to_type { using type = typename std::tuple_element<index, std::tuple<Types...>>::type; };
\ No newline at end of file
+struct int_to_type { using type = typename std::tuple_element<index, std::tuple<Types...>>::type; };
+
+// Maps a type to the position of its first occurrence in Types
+template<typename T, typename... Types>
+struct type_to_index;
+
+template<typename T, typename... Types>
+struct type_to_index<T, T, Types...> { static constexpr size_t value = 0; };
+
+template<typename T, typename First, typename... Types>
+struct type_to_index<T, First, Types...> { static constexpr size_t value = 1 + type_to_index<T, Types...>::value; };
+// Extracts the argument types of a function pointer, member function pointer or non-generic lambda as a tuple
+template<typename F>
+struct function_arguments : function_arguments<decltype(&F::operator())> {};
+
+template<typename R, typename... Args>
+struct function_arguments<R(*)(Args...)> { using type = std::tuple<Args...>; };
+
+template<typename R, typename C, typename... Args>
+struct function_arguments<R(C::*)(Args...)> { using type = std::tuple<Args...>; };
+
+template<typename R, typename C, typename... Args>
+struct function_arguments<R(C::*)(Args...) const> { using type = std::tuple<Args...>; };
+
+// Abbreviated type
+template<typename F>
+using function_arguments_t = typename function_arguments<F>::type;
+
+// Evaluates to true if the argument types of F can be extracted, which isn't the case for generic lambdas
+template<typename F, typename Attempt = void>
+struct has_function_arguments : public std::is_function<std::remove_pointer_t<F>> {};
+
+template<typename F>
+struct has_function_arguments<F, std::void_t<decltype(&F::operator())>> : public std::true_type {};
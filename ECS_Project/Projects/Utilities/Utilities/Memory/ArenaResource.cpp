@@ -0,0 +1,84 @@
+#include "pch_Utilities.hpp"
+#include "ArenaResource.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace Memory
+{
+	namespace
+	{
+		// Blocks are aligned like this upstream, and the block header is padded to keep the first allocation aligned
+		constexpr size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+	}
+
+	ArenaResource::ArenaResource(const size_t initialBlockSize, std::pmr::memory_resource* upstream) :
+		m_upstream(upstream),
+		m_initialBlockSize(std::max<size_t>(initialBlockSize, 1024)),
+		m_nextBlockSize(m_initialBlockSize)
+	{
+	}
+	ArenaResource::~ArenaResource()
+	{
+		release();
+	}
+
+	void ArenaResource::release() noexcept
+	{
+		while (m_lastBlock)
+		{
+			Block* previous = m_lastBlock->previous;
+			m_upstream->deallocate(m_lastBlock, m_lastBlock->size, BLOCK_ALIGNMENT);
+			m_lastBlock = previous;
+		}
+
+		m_current = nullptr;
+		m_end = nullptr;
+		m_nextBlockSize = m_initialBlockSize;
+		m_used = 0;
+		m_reserved = 0;
+	}
+
+	void* ArenaResource::do_allocate(const size_t bytes, const size_t alignment)
+	{
+		const auto alignedAddress = [alignment](unsigned char* pointer)
+		{
+			const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(pointer);
+			return reinterpret_cast<unsigned char*>((address + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1));
+		};
+
+		unsigned char* pointer = alignedAddress(m_current);
+		if (!m_current || pointer + bytes > m_end)
+		{
+			allocateBlock(bytes + alignment);
+			pointer = alignedAddress(m_current);
+		}
+
+		m_used += static_cast<size_t>(pointer + bytes - m_current);
+		m_current = pointer + bytes;
+		return pointer;
+	}
+	void ArenaResource::do_deallocate(void*, size_t, size_t)
+	{
+		// Memory is only returned by release()
+	}
+	bool ArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return (this == &other);
+	}
+
+	void ArenaResource::allocateBlock(const size_t minimumSize)
+	{
+		constexpr size_t HEADER_SIZE = (sizeof(Block) + BLOCK_ALIGNMENT - 1) / BLOCK_ALIGNMENT * BLOCK_ALIGNMENT;
+
+		const size_t size = std::max(m_nextBlockSize, HEADER_SIZE + minimumSize);
+		Block* block = static_cast<Block*>(m_upstream->allocate(size, BLOCK_ALIGNMENT));
+		block->previous = m_lastBlock;
+		block->size = size;
+
+		m_lastBlock = block;
+		m_current = reinterpret_cast<unsigned char*>(block) + HEADER_SIZE;
+		m_end = reinterpret_cast<unsigned char*>(block) + size;
+		m_nextBlockSize = size * 2;
+		m_reserved += size;
+	}
+}
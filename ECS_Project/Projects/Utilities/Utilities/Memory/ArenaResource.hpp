@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+
+namespace Memory
+{
+	/*
+		Monotonic memory resource which hands out memory from large blocks by bumping a pointer.
+		Deallocation does nothing, and all memory is returned at once by release() or when the arena is destroyed.
+		Every block is twice as large as the previous one, so the number of blocks grows logarithmically.
+		Not thread safe.
+	*/
+	class ArenaResource final : public std::pmr::memory_resource
+	{
+	public:
+		explicit ArenaResource(const size_t initialBlockSize = 64 * 1024, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+		ArenaResource(const ArenaResource& other) = delete;
+		~ArenaResource();
+		ArenaResource& operator=(const ArenaResource& other) = delete;
+
+		// Returns every block to the upstream resource. Memory handed out before is no longer valid
+		void release() noexcept;
+
+		// Bytes handed out since the last release, including alignment padding
+		[[nodiscard]] size_t used() const noexcept { return m_used; }
+		// Bytes held from the upstream resource
+		[[nodiscard]] size_t reserved() const noexcept { return m_reserved; }
+
+	private:
+		struct Block
+		{
+			Block* previous;
+			size_t size;
+		};
+
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		void allocateBlock(const size_t minimumSize);
+
+	private:
+		std::pmr::memory_resource* m_upstream;
+		size_t m_initialBlockSize;
+		size_t m_nextBlockSize;
+
+		// Most recently allocated block, which the others are linked from
+		Block* m_lastBlock = nullptr;
+		unsigned char* m_current = nullptr;
+		unsigned char* m_end = nullptr;
+
+		size_t m_used = 0;
+		size_t m_reserved = 0;
+	};
+}
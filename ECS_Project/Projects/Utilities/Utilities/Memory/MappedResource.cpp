@@ -0,0 +1,228 @@
+#include "pch_Utilities.hpp"
+#include "MappedResource.hpp"
+#include "PoolResource.hpp"
+#include <algorithm>
+#include <new>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Memory
+{
+	namespace
+	{
+		// Regions start at multiples of this within the file, which suits the allocation granularity of every platform
+		constexpr size_t REGION_GRANULARITY = 64 * 1024;
+
+		static_assert(PoolResource::CHUNK_SIZE <= MappedResource::MAX_SHARED_SIZE, "Chunks of a PoolResource would get a region each");
+
+		size_t roundUp(const size_t size, const size_t multiple) noexcept
+		{
+			return (size + multiple - 1) / multiple * multiple;
+		}
+	}
+
+#ifdef _WIN32
+	MappedResource::MappedResource(const std::string& path, const Access access) : m_access(access)
+	{
+		const DWORD hint = (access == Access::Sequential ? FILE_FLAG_SEQUENTIAL_SCAN : (access == Access::Random ? FILE_FLAG_RANDOM_ACCESS : 0));
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE | hint, nullptr);
+		m_file = (file != INVALID_HANDLE_VALUE ? file : nullptr);
+	}
+#else
+	MappedResource::MappedResource(const std::string& path, const Access access) : m_access(access)
+	{
+		// The mappings keep the file alive after it's unlinked, which deletes it even if the process is killed
+		m_file = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+		if (m_file != -1)
+		{
+			unlink(path.c_str());
+		}
+	}
+#endif
+	MappedResource::~MappedResource()
+	{
+		for (const Region& region : m_largeRegions)
+		{
+			unmapRegion(region, false);
+		}
+		for (const Region& region : m_regions)
+		{
+			unmapRegion(region, false);
+		}
+
+		if (isOpen())
+		{
+#ifdef _WIN32
+			CloseHandle(m_file);
+#else
+			::close(m_file);
+#endif
+		}
+	}
+
+	bool MappedResource::isOpen() const noexcept
+	{
+#ifdef _WIN32
+		return (m_file != nullptr);
+#else
+		return (m_file != -1);
+#endif
+	}
+
+	void MappedResource::pageOut() noexcept
+	{
+		const auto pageOutRegion = [](const Region& region)
+		{
+#ifdef _WIN32
+			// Unlocking pages which aren't locked removes them from the working set
+			FlushViewOfFile(region.memory, region.size);
+			VirtualUnlock(region.memory, region.size);
+#elif defined(MADV_PAGEOUT)
+			madvise(region.memory, region.size, MADV_PAGEOUT);
+#else
+			// Shared file pages keep their contents, and are only unmapped from the process
+			msync(region.memory, region.size, MS_ASYNC);
+			madvise(region.memory, region.size, MADV_DONTNEED);
+#endif
+		};
+
+		std::for_each(m_regions.begin(), m_regions.end(), pageOutRegion);
+		std::for_each(m_largeRegions.begin(), m_largeRegions.end(), pageOutRegion);
+	}
+
+	void* MappedResource::do_allocate(const size_t bytes, const size_t alignment)
+	{
+		if (alignment > PAGE_ALIGNMENT)
+		{
+			throw std::bad_alloc();
+		}
+
+		if (bytes > MAX_SHARED_SIZE)
+		{
+			m_largeRegions.reserve(m_largeRegions.size() + 1);
+			const Region region = mapRegion(bytes);
+			m_largeRegions.push_back(region);
+			return region.memory;
+		}
+
+		const auto alignedAddress = [alignment](unsigned char* pointer)
+		{
+			const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(pointer);
+			return reinterpret_cast<unsigned char*>((address + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1));
+		};
+
+		unsigned char* memory = alignedAddress(m_current);
+		if (!m_current || memory + bytes > m_end)
+		{
+			m_regions.reserve(m_regions.size() + 1);
+			const Region region = mapRegion(REGION_SIZE);
+			m_regions.push_back(region);
+			m_current = region.memory;
+			m_end = region.memory + region.size;
+			memory = alignedAddress(m_current);
+		}
+		m_current = memory + bytes;
+		return memory;
+	}
+	void MappedResource::do_deallocate(void* pointer, const size_t bytes, const size_t)
+	{
+		// Shared regions are kept as a whole until the resource is destroyed
+		if (bytes <= MAX_SHARED_SIZE)
+		{
+			return;
+		}
+
+		const auto region = std::find_if(m_largeRegions.begin(), m_largeRegions.end(), [pointer](const Region& r) { return r.memory == pointer; });
+		if (region != m_largeRegions.end())
+		{
+			unmapRegion(*region, true);
+			*region = m_largeRegions.back();
+			m_largeRegions.pop_back();
+		}
+	}
+	bool MappedResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return (this == &other);
+	}
+
+#ifdef _WIN32
+	MappedResource::Region MappedResource::mapRegion(const size_t size)
+	{
+		const size_t regionSize = roundUp(size, REGION_GRANULARITY);
+		const std::uint64_t offset = m_fileSize;
+		const std::uint64_t fileSize = offset + regionSize;
+		if (!isOpen())
+		{
+			throw std::bad_alloc();
+		}
+
+		// Creating a mapping larger than the file grows the file
+		HANDLE mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, static_cast<DWORD>(fileSize >> 32), static_cast<DWORD>(fileSize), nullptr);
+		void* memory = (mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), regionSize) : nullptr);
+		if (!memory)
+		{
+			if (mapping)
+			{
+				CloseHandle(mapping);
+			}
+			throw std::bad_alloc();
+		}
+
+		m_fileSize = fileSize;
+		m_mapped += regionSize;
+		return { static_cast<unsigned char*>(memory), regionSize, offset, mapping };
+	}
+	void MappedResource::unmapRegion(const Region& region, const bool) noexcept
+	{
+		// The file is deleted as a whole once it's closed
+		UnmapViewOfFile(region.memory);
+		CloseHandle(region.mapping);
+		m_mapped -= region.size;
+	}
+#else
+	MappedResource::Region MappedResource::mapRegion(const size_t size)
+	{
+		const size_t regionSize = roundUp(size, REGION_GRANULARITY);
+		const std::uint64_t offset = m_fileSize;
+		if (!isOpen() || ftruncate(m_file, static_cast<off_t>(offset + regionSize)) != 0)
+		{
+			throw std::bad_alloc();
+		}
+
+		void* memory = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, static_cast<off_t>(offset));
+		if (memory == MAP_FAILED)
+		{
+			throw std::bad_alloc();
+		}
+		madvise(memory, regionSize, (m_access == Access::Sequential ? MADV_SEQUENTIAL : (m_access == Access::Random ? MADV_RANDOM : MADV_NORMAL)));
+
+		m_fileSize = offset + regionSize;
+		m_mapped += regionSize;
+		return { static_cast<unsigned char*>(memory), regionSize, offset };
+	}
+	void MappedResource::unmapRegion(const Region& region, const bool isReleased) noexcept
+	{
+		munmap(region.memory, region.size);
+		m_mapped -= region.size;
+
+#if defined(FALLOC_FL_PUNCH_HOLE)
+		// The file keeps its size, but the disk space of the region is freed
+		if (isReleased)
+		{
+			fallocate(m_file, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(region.offset), static_cast<off_t>(region.size));
+		}
+#else
+		static_cast<void>(isReleased);
+#endif
+	}
+#endif
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+namespace Memory
+{
+	/*
+		Memory resource backed by a temporary file, for storage which may be larger than physical memory.
+		Memory is mapped from the file in regions, so under memory pressure the OS writes cold pages back to the file and drops them,
+		while pages in use stay resident like any other memory.
+		Allocations larger than MAX_SHARED_SIZE get a region of their own, which is unmapped and cut out of the file again when it's deallocated.
+		Smaller ones are carved out of shared regions, and are only given back when the resource is destroyed.
+
+		Small allocations are therefore meant to be pooled on top of this resource, i.e. like
+			Memory::MappedResource mapped(path);
+			Memory::PoolResource pool(&mapped);	// Reuses freed blocks, and takes its chunks from the shared regions
+		where freed blocks between PoolResource::MAX_BLOCK_SIZE and MAX_SHARED_SIZE aren't reused.
+
+		Alignments up to PAGE_ALIGNMENT are supported. Allocations throw std::bad_alloc if the file can't be grown or mapped.
+		Not thread safe.
+	*/
+	class MappedResource final : public std::pmr::memory_resource
+	{
+	public:
+		// How the memory is expected to be accessed, which tells the OS how far to read ahead when pages are read back in
+		enum class Access
+		{
+			Normal,
+			Sequential,	// Scanned from start to end, such as pools iterated by views
+			Random
+		};
+
+		// Largest allocation carved out of the shared regions, which fits the chunks of a PoolResource
+		static constexpr size_t MAX_SHARED_SIZE = 64 * 1024;
+		static constexpr size_t PAGE_ALIGNMENT = 4096;
+
+		// Bytes mapped at a time for the shared regions
+		static constexpr size_t REGION_SIZE = 64 * 1024 * 1024;
+
+		// Creates the file at the path, replacing any file already there. It's deleted again when the resource is destroyed, or right away where possible
+		explicit MappedResource(const std::string& path, const Access access = Access::Sequential);
+		MappedResource(const MappedResource& other) = delete;
+		~MappedResource();
+		MappedResource& operator=(const MappedResource& other) = delete;
+
+		// False if the file couldn't be created, in which case every allocation fails
+		[[nodiscard]] bool isOpen() const noexcept;
+
+		// Writes changed pages back to the file and drops every page from memory, to be read back when it's touched again
+		// Useful for pools which won't be used for a while, ahead of the OS deciding to
+		void pageOut() noexcept;
+
+		// Bytes currently mapped from the file
+		[[nodiscard]] size_t mapped() const noexcept { return m_mapped; }
+
+	private:
+		// Part of the file mapped into memory
+		struct Region
+		{
+			unsigned char* memory;
+			size_t size;
+			std::uint64_t offset;
+#ifdef _WIN32
+			void* mapping;
+#endif
+		};
+
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		// Grows the file and maps the new part of it. Throws std::bad_alloc if that fails
+		Region mapRegion(const size_t size);
+		// Unmaps a region, and releases its part of the file if it won't be mapped again
+		void unmapRegion(const Region& region, const bool isReleased) noexcept;
+
+	private:
+		Access m_access;
+
+		// Regions which small allocations are carved from, and the unused part of the last one
+		std::vector<Region> m_regions;
+		unsigned char* m_current = nullptr;
+		unsigned char* m_end = nullptr;
+
+		// Regions of single large allocations
+		std::vector<Region> m_largeRegions;
+
+		// Size of the file, which only grows, as released parts are cut out of it instead
+		std::uint64_t m_fileSize = 0;
+		size_t m_mapped = 0;
+
+#ifdef _WIN32
+		void* m_file = nullptr;
+#else
+		int m_file = -1;
+#endif
+	};
+}
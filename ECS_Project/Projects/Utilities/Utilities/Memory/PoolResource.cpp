@@ -0,0 +1,86 @@
+#include "pch_Utilities.hpp"
+#include "PoolResource.hpp"
+#include <algorithm>
+
+namespace Memory
+{
+	PoolResource::PoolResource(std::pmr::memory_resource* upstream) : m_upstream(upstream)
+	{
+	}
+	PoolResource::~PoolResource()
+	{
+		release();
+	}
+
+	void PoolResource::release() noexcept
+	{
+		for (const Chunk& chunk : m_chunks)
+		{
+			m_upstream->deallocate(chunk.memory, CHUNK_SIZE, chunk.alignment);
+		}
+		m_chunks.clear();
+		m_freeLists.fill(nullptr);
+	}
+
+	void* PoolResource::do_allocate(const size_t bytes, const size_t alignment)
+	{
+		if (std::max(bytes, alignment) > MAX_BLOCK_SIZE)
+		{
+			return m_upstream->allocate(bytes, alignment);
+		}
+
+		const size_t sizeClass = classOf(bytes, alignment);
+		if (!m_freeLists[sizeClass])
+		{
+			refill(sizeClass);
+		}
+
+		FreeBlock* block = m_freeLists[sizeClass];
+		m_freeLists[sizeClass] = block->next;
+		return block;
+	}
+	void PoolResource::do_deallocate(void* pointer, const size_t bytes, const size_t alignment)
+	{
+		if (std::max(bytes, alignment) > MAX_BLOCK_SIZE)
+		{
+			m_upstream->deallocate(pointer, bytes, alignment);
+			return;
+		}
+
+		const size_t sizeClass = classOf(bytes, alignment);
+		FreeBlock* block = static_cast<FreeBlock*>(pointer);
+		block->next = m_freeLists[sizeClass];
+		m_freeLists[sizeClass] = block;
+	}
+	bool PoolResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+	{
+		return (this == &other);
+	}
+
+	size_t PoolResource::classOf(const size_t bytes, const size_t alignment) noexcept
+	{
+		const size_t size = std::max(bytes, alignment);
+		size_t sizeClass = 0;
+		while ((MIN_BLOCK_SIZE << sizeClass) < size)
+		{
+			sizeClass++;
+		}
+		return sizeClass;
+	}
+	void PoolResource::refill(const size_t sizeClass)
+	{
+		// Chunks are aligned to their block size, which keeps every block aligned to any alignment it was chosen for
+		const size_t blockSize = MIN_BLOCK_SIZE << sizeClass;
+		m_chunks.reserve(m_chunks.size() + 1);
+		unsigned char* memory = static_cast<unsigned char*>(m_upstream->allocate(CHUNK_SIZE, blockSize));
+		m_chunks.push_back({ memory, blockSize });
+
+		// Link the blocks in address order
+		for (size_t offset = CHUNK_SIZE; offset >= blockSize; offset -= blockSize)
+		{
+			FreeBlock* block = reinterpret_cast<FreeBlock*>(memory + offset - blockSize);
+			block->next = m_freeLists[sizeClass];
+			m_freeLists[sizeClass] = block;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace Memory
+{
+	/*
+		Memory resource which serves allocations from free lists of fixed size classes.
+		Every size class is a power of two between MIN_BLOCK_SIZE and MAX_BLOCK_SIZE, and is carved out of chunks from the upstream resource.
+		Freed blocks are reused by later allocations of the same class, and chunks are only returned by release() or when the resource is destroyed.
+		Larger allocations are passed directly to the upstream resource.
+		Not thread safe, which avoids the locking of the global heap when each world has its own resource.
+	*/
+	class PoolResource final : public std::pmr::memory_resource
+	{
+	public:
+		static constexpr size_t MIN_BLOCK_SIZE = 8;
+		static constexpr size_t MAX_BLOCK_SIZE = 4096;
+
+		// Bytes per chunk, which always holds at least a few blocks of the largest class
+		static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+		explicit PoolResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+		PoolResource(const PoolResource& other) = delete;
+		~PoolResource();
+		PoolResource& operator=(const PoolResource& other) = delete;
+
+		// Returns every chunk to the upstream resource. Memory handed out from the size classes is no longer valid
+		void release() noexcept;
+
+		// Bytes held from the upstream resource by the size classes
+		[[nodiscard]] size_t reserved() const noexcept { return m_chunks.size() * CHUNK_SIZE; }
+
+	private:
+		struct FreeBlock
+		{
+			FreeBlock* next;
+		};
+
+		struct Chunk
+		{
+			void* memory;
+			size_t alignment;
+		};
+
+		static constexpr size_t CLASS_COUNT = 10;
+		static_assert((MIN_BLOCK_SIZE << (CLASS_COUNT - 1)) == MAX_BLOCK_SIZE, "Size classes don't cover every power of two");
+
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		// Index of the smallest class which fits the size and alignment
+		static size_t classOf(const size_t bytes, const size_t alignment) noexcept;
+		void refill(const size_t sizeClass);
+
+	private:
+		std::pmr::memory_resource* m_upstream;
+		std::array<FreeBlock*, CLASS_COUNT> m_freeLists{};
+		std::vector<Chunk> m_chunks;
+	};
+}
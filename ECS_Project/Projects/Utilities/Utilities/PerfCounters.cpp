@@ -0,0 +1,192 @@
+#include "pch_Utilities.hpp"
+#include "PerfCounters.hpp"
+#include <atomic>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace Timer
+{
+	namespace
+	{
+		std::atomic<bool> s_areCountersEnabled{ false };
+
+		// Entities visited by the calling thread within counted scopes
+		thread_local std::uint64_t t_entities = 0;
+
+#ifdef __linux__
+		struct EventType
+		{
+			std::uint32_t type;
+			std::uint64_t config;
+		};
+
+		// Indexed by Counter
+		constexpr EventType EVENT_TYPES[COUNTER_COUNT] =
+		{
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+			{ PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES }
+		};
+
+		// Counters of one thread, opened as a group led by the cycle counter
+		struct ThreadCounters
+		{
+			ThreadCounters()
+			{
+				for (size_t counter = 0; counter < COUNTER_COUNT; counter++)
+				{
+					perf_event_attr attributes{};
+					attributes.size = sizeof(perf_event_attr);
+					attributes.type = EVENT_TYPES[counter].type;
+					attributes.config = EVENT_TYPES[counter].config;
+					attributes.exclude_kernel = 1;
+					attributes.exclude_hv = 1;
+					attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+					// Counts the calling thread on any CPU. Without the cycle counter there's no group to add the others to
+					const int fd = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, leader, 0));
+					if (fd == -1)
+					{
+						if (counter == 0)
+						{
+							return;
+						}
+						continue;
+					}
+
+					if (leader == -1)
+					{
+						leader = fd;
+					}
+					else
+					{
+						fds[openCount] = fd;
+					}
+					counters[openCount++] = counter;
+				}
+			}
+			~ThreadCounters()
+			{
+				for (size_t i = 1; i < openCount; i++)
+				{
+					close(fds[i]);
+				}
+				if (leader != -1)
+				{
+					close(leader);
+				}
+			}
+
+			bool read(CounterReading& reading) const noexcept
+			{
+				// Laid out as PERF_FORMAT_GROUP with both times
+				struct GroupValues
+				{
+					std::uint64_t count;
+					std::uint64_t timeEnabled;
+					std::uint64_t timeRunning;
+					std::uint64_t values[COUNTER_COUNT];
+				} group{};
+
+				if (leader == -1 || ::read(leader, &group, sizeof(group)) <= 0 || group.count != openCount)
+				{
+					return false;
+				}
+
+				// The counts are kept unscaled, as the times they're scaled by are only meaningful between two readings
+				reading.counts.fill(0);
+				for (size_t i = 0; i < openCount; i++)
+				{
+					reading.counts[counters[i]] = group.values[i];
+				}
+				reading.timeEnabled = group.timeEnabled;
+				reading.timeRunning = group.timeRunning;
+				return true;
+			}
+
+			int leader = -1;
+			// Descriptors of the members after the leader, and the counter of every opened event in the order they're read
+			int fds[COUNTER_COUNT] = {};
+			size_t counters[COUNTER_COUNT] = {};
+			size_t openCount = 0;
+		};
+#endif
+	}
+
+	bool setCountersEnabled(const bool isEnabled)
+	{
+		CounterReading reading;
+		if (isEnabled && !readCounters(reading))
+		{
+			return false;
+		}
+
+		s_areCountersEnabled.store(isEnabled, std::memory_order_relaxed);
+		return true;
+	}
+	bool areCountersEnabled() noexcept
+	{
+		return s_areCountersEnabled.load(std::memory_order_relaxed);
+	}
+
+	bool readCounters(CounterReading& reading) noexcept
+	{
+#ifdef __linux__
+		thread_local const ThreadCounters t_counters;
+		return t_counters.read(reading);
+#else
+		static_cast<void>(reading);
+		return false;
+#endif
+	}
+
+	CounterValues countsBetween(const CounterReading& start, const CounterReading& end) noexcept
+	{
+		// Scales the counts up if the group shared the hardware with other groups for part of the time between the readings
+		const std::uint64_t timeEnabled = end.timeEnabled - start.timeEnabled;
+		const std::uint64_t timeRunning = end.timeRunning - start.timeRunning;
+		const double scale = (timeRunning > 0 && timeRunning < timeEnabled ? static_cast<double>(timeEnabled) / static_cast<double>(timeRunning) : 1.0);
+
+		CounterValues counts{};
+		for (size_t counter = 0; counter < COUNTER_COUNT; counter++)
+		{
+			// Raw counts of one thread only ever grow
+			const std::uint64_t count = (end.counts[counter] > start.counts[counter] ? end.counts[counter] - start.counts[counter] : 0);
+			counts[counter] = (scale == 1.0 ? count : static_cast<std::uint64_t>(static_cast<double>(count) * scale));
+		}
+		return counts;
+	}
+
+	CountedScope::CountedScope(const Label label) noexcept :
+		m_label(label), m_isCounting(areCountersEnabled() && readCounters(m_start)), m_startEntities(t_entities)
+	{
+	}
+	CountedScope::~CountedScope()
+	{
+		CounterReading end;
+		if (!m_isCounting || !readCounters(end))
+		{
+			return;
+		}
+
+		try
+		{
+			recordCounters(m_label, countsBetween(m_start, end), t_entities - m_startEntities);
+		}
+		catch (...)
+		{
+			// Counts are dropped if their totals can't grow, like scopes which don't fit in their ring
+		}
+	}
+
+	void CountedScope::addEntities(const std::uint64_t count) noexcept
+	{
+		t_entities += count;
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include "Timer.hpp"
+
+/*
+	Hardware performance counters of the calling thread, read around scopes to tell whether they're bound by cache misses or branches.
+
+	Counters are opened through perf_event_open on Linux, once per thread as a group which is read with a single system call.
+	They're unavailable on other platforms, and where the kernel or a virtual machine doesn't expose them, such as with
+	perf_event_paranoid above 2. Counting then stays off, and scopes are only timed. Events the CPU lacks read as zero.
+
+	Reading the counters costs a system call at each end of a scope, which is why counting is off by default.
+*/
+namespace Timer
+{
+	// Turns counting on or off. Returns false if the counters of the calling thread can't be opened, which leaves counting off
+	bool setCountersEnabled(const bool isEnabled);
+	[[nodiscard]] bool areCountersEnabled() noexcept;
+
+	// Counts since the counters of a thread were opened, and for how long they were enabled and actually counting
+	// The two times differ when the counters shared the hardware with others, which countsBetween scales for
+	struct CounterReading
+	{
+		CounterValues counts{};
+		std::uint64_t timeEnabled = 0;
+		std::uint64_t timeRunning = 0;
+	};
+
+	// Reads the counters of the calling thread, opening them on the first call
+	// Returns false if they can't be opened or read, in which case the reading is left as it was
+	bool readCounters(CounterReading& reading) noexcept;
+
+	// Events between two readings of the same thread, scaled up by the part of the time between them that the counters weren't running
+	[[nodiscard]] CounterValues countsBetween(const CounterReading& start, const CounterReading& end) noexcept;
+
+	// Counts the hardware events of the scope it lives in, and adds them to its label in report() when it ends
+	// Entities visited by the scope are added by the views it iterates, or by addEntities, including those of nested counted scopes
+	// Only events of the calling thread are counted, meaning that work the scope hands to other threads isn't
+	class CountedScope final
+	{
+	public:
+		explicit CountedScope(const Label label) noexcept;
+		CountedScope(const CountedScope& other) = delete;
+		~CountedScope();
+		CountedScope& operator=(const CountedScope& other) = delete;
+
+		// Adds entities visited by the calling thread to this scope and every counted scope around it
+		static void addEntities(const std::uint64_t count) noexcept;
+
+	private:
+		Label m_label;
+		bool m_isCounting;
+		CounterReading m_start;
+		std::uint64_t m_startEntities = 0;
+	};
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+namespace Serialization
+{
+	class BinaryWriter;
+
+	/*
+		Reads what a BinaryWriter wrote, from memory such as a MappedFile.
+		Reads skip the same padding as the writes did, and fail once they would pass the end, after which every read fails.
+		The memory must start at an address aligned like the largest alignment written, which mapped files and BinaryWriter buffers always are.
+	*/
+	class BinaryReader final
+	{
+	public:
+		BinaryReader(const unsigned char* data, const size_t size) noexcept : m_data(data), m_size(size) {}
+
+		// Returns the next size bytes, or null if they're past the end
+		const void* readBytes(const size_t size, const size_t alignment = 1) noexcept
+		{
+			align(alignment);
+			if (!m_isGood || size > m_size - m_position)
+			{
+				m_isGood = false;
+				return nullptr;
+			}
+
+			const void* data = m_data + m_position;
+			m_position += size;
+			return data;
+		}
+
+		template<typename T>
+		bool read(T& value) noexcept
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be read as bytes");
+
+			const void* data = readBytes(sizeof(T), alignof(T));
+			if (data)
+			{
+				std::memcpy(&value, data, sizeof(T));
+			}
+			return (data != nullptr);
+		}
+
+		void align(const size_t alignment) noexcept
+		{
+			const size_t padding = (alignment > 1 ? (alignment - m_position % alignment) % alignment : 0);
+			if (padding > m_size - m_position)
+			{
+				m_isGood = false;
+				return;
+			}
+			m_position += padding;
+		}
+
+		// Lets a caller reject what it read, such as a value out of range, which fails every later read
+		void fail() noexcept { m_isGood = false; }
+
+		// True if every read so far succeeded
+		[[nodiscard]] bool isGood() const noexcept { return m_isGood; }
+		[[nodiscard]] size_t position() const noexcept { return m_position; }
+
+	private:
+		const unsigned char* m_data;
+		size_t m_size;
+		size_t m_position = 0;
+		bool m_isGood = true;
+	};
+
+	// Default evaluates to false
+	template<typename T, typename Attempt = void>
+	struct has_serialization_hooks : public std::false_type {};
+
+	// Evaluates to true if type T has the member functions
+	//		void save(Serialization::BinaryWriter& writer) const;
+	//		static T load(Serialization::BinaryReader& reader);
+	// which are then used in place of copying its bytes, such as for types owning memory
+	template<typename T>
+	struct has_serialization_hooks<T, std::void_t<
+		decltype(std::declval<const T&>().save(std::declval<BinaryWriter&>())),
+		std::enable_if_t<std::is_same_v<decltype(T::load(std::declval<BinaryReader&>())), T>>>> : public std::true_type {};
+
+	// Evaluates to true if type T can be saved and loaded, either through its hooks or by copying its bytes
+	template<typename T>
+	struct is_serializable : public std::bool_constant<has_serialization_hooks<T>::value || std::is_trivially_copyable_v<T>> {};
+}
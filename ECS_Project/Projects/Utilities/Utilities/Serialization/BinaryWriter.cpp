@@ -0,0 +1,102 @@
+#include "pch_Utilities.hpp"
+#include "BinaryWriter.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace Serialization
+{
+	BinaryWriter::BinaryWriter(const std::string& path) : m_isFile(true)
+	{
+#ifdef _MSC_VER
+		if (fopen_s(&m_file, path.c_str(), "wb") != 0)
+		{
+			m_file = nullptr;
+		}
+#else
+		m_file = std::fopen(path.c_str(), "wb");
+#endif
+		if (m_file)
+		{
+			// Large writes are passed straight through, so a big buffer only helps the many small ones
+			std::setvbuf(m_file, nullptr, _IOFBF, 1 << 20);
+		}
+	}
+	BinaryWriter::~BinaryWriter()
+	{
+		close();
+		if (m_buffer)
+		{
+			m_resource->deallocate(m_buffer, m_capacity, BUFFER_ALIGNMENT);
+		}
+	}
+
+	void BinaryWriter::writeBytes(const void* data, const size_t size, const size_t alignment)
+	{
+		align(alignment);
+		if (!isGood() || size == 0)
+		{
+			return;
+		}
+
+		append(data, size);
+	}
+	void BinaryWriter::align(const size_t alignment)
+	{
+		static constexpr unsigned char ZEROES[64] = {};
+
+		size_t padding = (alignment > 1 ? (alignment - m_position % alignment) % alignment : 0);
+		while (isGood() && padding > 0)
+		{
+			const size_t count = (padding < sizeof(ZEROES) ? padding : sizeof(ZEROES));
+			append(ZEROES, count);
+			padding -= count;
+		}
+	}
+
+	void BinaryWriter::append(const void* data, const size_t size)
+	{
+		if (m_isFile)
+		{
+			m_isGood = (std::fwrite(data, 1, size, m_file) == size);
+		}
+		else
+		{
+			if (m_position + size > m_capacity)
+			{
+				// Grow geometrically, so that a buffer reused for similar contents soon stops reallocating
+				const size_t capacity = std::max(m_position + size, std::max(m_capacity * 2, BUFFER_ALIGNMENT));
+				unsigned char* buffer = static_cast<unsigned char*>(m_resource->allocate(capacity, BUFFER_ALIGNMENT));
+				if (m_buffer)
+				{
+					std::memcpy(buffer, m_buffer, m_position);
+					m_resource->deallocate(m_buffer, m_capacity, BUFFER_ALIGNMENT);
+				}
+				m_buffer = buffer;
+				m_capacity = capacity;
+			}
+			std::memcpy(m_buffer + m_position, data, size);
+		}
+		m_position += size;
+	}
+
+	void BinaryWriter::clear() noexcept
+	{
+		if (!m_isFile)
+		{
+			m_position = 0;
+			m_isGood = true;
+		}
+	}
+
+	bool BinaryWriter::close()
+	{
+		if (!m_file)
+		{
+			return (!m_isFile && m_isGood);
+		}
+
+		m_isGood = (std::fclose(m_file) == 0) && m_isGood;
+		m_file = nullptr;
+		return m_isGood;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdio>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+
+namespace Serialization
+{
+	/*
+		Writes raw bytes to a file or to a buffer in memory, padding each write to its alignment relative to the start.
+		A file which is later mapped with MappedFile and read with BinaryReader therefore has every value aligned in memory,
+		as does the buffer, which is allocated with the largest alignment a value can have.
+		Values are written in the byte order of the machine.
+	*/
+	class BinaryWriter final
+	{
+	public:
+		// Alignment of the memory buffer
+		static constexpr size_t BUFFER_ALIGNMENT = 64;
+
+		// Writes to a buffer allocated from the resource, which is kept by clear so that it can be reused
+		explicit BinaryWriter(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) noexcept : m_resource(resource) {}
+		// Writes to a file, replacing it if it exists
+		explicit BinaryWriter(const std::string& path);
+		BinaryWriter(const BinaryWriter& other) = delete;
+		~BinaryWriter();
+		BinaryWriter& operator=(const BinaryWriter& other) = delete;
+
+		void writeBytes(const void* data, const size_t size, const size_t alignment = 1);
+
+		template<typename T>
+		void write(const T& value)
+		{
+			static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values can be written as bytes");
+			writeBytes(&value, sizeof(T), alignof(T));
+		}
+
+		// Pads with zeroes up to the next multiple of the alignment
+		void align(const size_t alignment);
+
+		// Flushes and closes the file. Returns true if it was opened and every write succeeded, or for a buffer, if every write succeeded
+		bool close();
+
+		// Empties the buffer without releasing it, and starts over from position zero
+		void clear() noexcept;
+
+		// True if every write so far succeeded, and the file was opened when writing to one
+		[[nodiscard]] bool isGood() const noexcept { return (m_file || !m_isFile) && m_isGood; }
+		// Bytes written so far, including padding
+		[[nodiscard]] size_t position() const noexcept { return m_position; }
+
+		// What has been written to the buffer. Empty when writing to a file
+		[[nodiscard]] const unsigned char* data() const noexcept { return m_buffer; }
+		[[nodiscard]] size_t size() const noexcept { return (m_isFile ? 0 : m_position); }
+
+	private:
+		void append(const void* data, const size_t size);
+
+	private:
+		std::FILE* m_file = nullptr;
+		bool m_isFile = false;
+
+		// Buffer and the resource it's allocated from, when not writing to a file
+		std::pmr::memory_resource* m_resource = nullptr;
+		unsigned char* m_buffer = nullptr;
+		size_t m_capacity = 0;
+
+		size_t m_position = 0;
+		bool m_isGood = true;
+	};
+}
@@ -0,0 +1,137 @@
+#include "pch_Utilities.hpp"
+#include "MappedFile.hpp"
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Serialization
+{
+	MappedFile::MappedFile(const std::string& path)
+	{
+		open(path);
+	}
+	MappedFile::MappedFile(MappedFile&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			close();
+			std::swap(m_data, other.m_data);
+			std::swap(m_size, other.m_size);
+#ifdef _WIN32
+			std::swap(m_file, other.m_file);
+			std::swap(m_mapping, other.m_mapping);
+#endif
+		}
+		return *this;
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!view)
+		{
+			CloseHandle(mapping);
+			CloseHandle(file);
+			return false;
+		}
+
+		m_file = file;
+		m_mapping = mapping;
+		m_data = static_cast<const unsigned char*>(view);
+		m_size = static_cast<size_t>(size.QuadPart);
+		return true;
+	}
+	void MappedFile::close() noexcept
+	{
+		if (m_data)
+		{
+			UnmapViewOfFile(m_data);
+			CloseHandle(m_mapping);
+			CloseHandle(m_file);
+		}
+		m_data = nullptr;
+		m_size = 0;
+		m_file = nullptr;
+		m_mapping = nullptr;
+	}
+#else
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+
+		const int file = ::open(path.c_str(), O_RDONLY);
+		if (file == -1)
+		{
+			return false;
+		}
+
+		struct stat status {};
+		if (fstat(file, &status) != 0 || status.st_size == 0)
+		{
+			::close(file);
+			return false;
+		}
+
+		// The mapping stays valid after the descriptor is closed
+		const size_t size = static_cast<size_t>(status.st_size);
+		void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file);
+		if (view == MAP_FAILED)
+		{
+			return false;
+		}
+		madvise(view, size, MADV_SEQUENTIAL);
+
+		m_data = static_cast<const unsigned char*>(view);
+		m_size = size;
+		return true;
+	}
+	void MappedFile::close() noexcept
+	{
+		if (m_data)
+		{
+			munmap(const_cast<unsigned char*>(m_data), m_size);
+		}
+		m_data = nullptr;
+		m_size = 0;
+	}
+#endif
+}
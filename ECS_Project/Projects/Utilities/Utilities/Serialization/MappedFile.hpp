@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace Serialization
+{
+	/*
+		Read-only memory mapping of a whole file.
+		Pages are read from the file when they're first touched, so reading a file costs little more than the I/O itself.
+		The mapping starts at a page boundary, which keeps any offset aligned to its alignment if it's aligned within the file.
+	*/
+	class MappedFile final
+	{
+	public:
+		MappedFile() = default;
+		explicit MappedFile(const std::string& path);
+		MappedFile(const MappedFile& other) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		~MappedFile();
+		MappedFile& operator=(const MappedFile& other) = delete;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		// Maps the file, replacing any previous mapping. Returns false if the file can't be mapped or is empty
+		bool open(const std::string& path);
+		void close() noexcept;
+
+		[[nodiscard]] bool isOpen() const noexcept { return m_data != nullptr; }
+		[[nodiscard]] const unsigned char* data() const noexcept { return m_data; }
+		[[nodiscard]] size_t size() const noexcept { return m_size; }
+
+	private:
+		const unsigned char* m_data = nullptr;
+		size_t m_size = 0;
+
+#ifdef _WIN32
+		// Handles of the file and its mapping object
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+	};
+}
@@ -0,0 +1,283 @@
+#pragma once
+#include <memory_resource>
+#include <tuple>
+#include <optional>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+
+/*
+	Structure-of-arrays storage.
+
+	A type opts in by listing its fields with MAKE_SOA after their declarations, like
+		struct Position
+		{
+			float x, y;
+			MAKE_SOA(Position, x, y);
+		};
+
+	Each listed field is then stored in its own aligned array, instead of storing whole objects after each other.
+	Elements are accessed through T::SoARef, which holds a reference to each field of an element,
+	or through T::SoAConstRef, which holds const references and can be made from a SoARef,
+	and whole arrays are accessed through T::SoASpan, which holds a pointer to the first element of each field
+	and can be indexed like an array of SoARef.
+	Listed fields must be trivially copyable, and any fields which aren't listed are not stored.
+*/
+
+// Helpers for applying a macro to each field, up to 8 fields
+#define SOA_EXPAND(x) x
+#define SOA_EACH_1(M, T, a) M(T, a)
+#define SOA_EACH_2(M, T, a, ...) M(T, a) SOA_EXPAND(SOA_EACH_1(M, T, __VA_ARGS__))
+#define SOA_EACH_3(M, T, a, ...) M(T, a) SOA_EXPAND(SOA_EACH_2(M, T, __VA_ARGS__))
+#define SOA_EACH_4(M, T, a, ...) M(T, a) SOA_EXPAND(SOA_EACH_3(M, T, __VA_ARGS__))
+#define SOA_EACH_5(M, T, a, ...) M(T, a) SOA_EXPAND(SOA_EACH_4(M, T, __VA_ARGS__))
+#define SOA_EACH_6(M, T, a, ...) M(T, a) SOA_EXPAND(SOA_EACH_5(M, T, __VA_ARGS__))
+#define SOA_EACH_7(M, T, a, ...) M(T, a) SOA_EXPAND(SOA_EACH_6(M, T, __VA_ARGS__))
+#define SOA_EACH_8(M, T, a, ...) M(T, a) SOA_EXPAND(SOA_EACH_7(M, T, __VA_ARGS__))
+#define SOA_LIST_1(M, T, a) M(T, a)
+#define SOA_LIST_2(M, T, a, ...) M(T, a), SOA_EXPAND(SOA_LIST_1(M, T, __VA_ARGS__))
+#define SOA_LIST_3(M, T, a, ...) M(T, a), SOA_EXPAND(SOA_LIST_2(M, T, __VA_ARGS__))
+#define SOA_LIST_4(M, T, a, ...) M(T, a), SOA_EXPAND(SOA_LIST_3(M, T, __VA_ARGS__))
+#define SOA_LIST_5(M, T, a, ...) M(T, a), SOA_EXPAND(SOA_LIST_4(M, T, __VA_ARGS__))
+#define SOA_LIST_6(M, T, a, ...) M(T, a), SOA_EXPAND(SOA_LIST_5(M, T, __VA_ARGS__))
+#define SOA_LIST_7(M, T, a, ...) M(T, a), SOA_EXPAND(SOA_LIST_6(M, T, __VA_ARGS__))
+#define SOA_LIST_8(M, T, a, ...) M(T, a), SOA_EXPAND(SOA_LIST_7(M, T, __VA_ARGS__))
+#define SOA_SELECT(_1, _2, _3, _4, _5, _6, _7, _8, NAME, ...) NAME
+#define SOA_FOR_EACH(M, T, ...) SOA_EXPAND(SOA_SELECT(__VA_ARGS__, SOA_EACH_8, SOA_EACH_7, SOA_EACH_6, SOA_EACH_5, SOA_EACH_4, SOA_EACH_3, SOA_EACH_2, SOA_EACH_1)(M, T, __VA_ARGS__))
+#define SOA_FOR_EACH_LIST(M, T, ...) SOA_EXPAND(SOA_SELECT(__VA_ARGS__, SOA_LIST_8, SOA_LIST_7, SOA_LIST_6, SOA_LIST_5, SOA_LIST_4, SOA_LIST_3, SOA_LIST_2, SOA_LIST_1)(M, T, __VA_ARGS__))
+
+#define SOA_REF_MEMBER(T, field) decltype(T::field)& field;
+#define SOA_CONST_REF_MEMBER(T, field) const decltype(T::field)& field;
+#define SOA_REF_INITIALIZER(T, field) field(ref.field)
+#define SOA_SPAN_MEMBER(T, field) decltype(T::field)* field;
+#define SOA_MEMBER_POINTER(T, field) &T::field
+#define SOA_SPAN_ELEMENT(T, field) field[index]
+
+// Stores the listed fields of a type in separate arrays. Must be placed after the fields are declared
+#define MAKE_SOA(Type, ...) \
+	struct SoARef { SOA_FOR_EACH(SOA_REF_MEMBER, Type, __VA_ARGS__) }; \
+	struct SoAConstRef \
+	{ \
+		SOA_FOR_EACH(SOA_CONST_REF_MEMBER, Type, __VA_ARGS__) \
+		SoAConstRef(const SoARef& ref) noexcept : SOA_FOR_EACH_LIST(SOA_REF_INITIALIZER, Type, __VA_ARGS__) {} \
+	}; \
+	struct SoASpan \
+	{ \
+		SOA_FOR_EACH(SOA_SPAN_MEMBER, Type, __VA_ARGS__) \
+		SoARef operator[](const std::size_t index) const noexcept { return { SOA_FOR_EACH_LIST(SOA_SPAN_ELEMENT, Type, __VA_ARGS__) }; } \
+	}; \
+	static constexpr auto soaMembers() noexcept { return std::make_tuple(SOA_FOR_EACH_LIST(SOA_MEMBER_POINTER, Type, __VA_ARGS__)); }
+
+
+// Default evaluates to false
+template<typename T, typename Attempt = void>
+struct has_soa_layout : public std::false_type {};
+
+// Evaluates to true if type T stores its fields as structure-of-arrays
+template<typename T>
+struct has_soa_layout<T, std::void_t<decltype(T::soaMembers())>> : public std::true_type {};
+
+// Start of densely stored elements of type T: a pointer to the first element, or a span of each field if T is stored as structure-of-arrays
+template<typename T, bool = has_soa_layout<T>::value>
+struct soa_dense_base
+{
+	using type = T*;
+};
+
+template<typename T>
+struct soa_dense_base<T, true>
+{
+	using type = typename T::SoASpan;
+};
+
+// Type of the field a member pointer points to
+template<typename MemberPointer>
+struct soa_field;
+
+template<typename Class, typename Field>
+struct soa_field<Field Class::*>
+{
+	using type = Field;
+};
+
+
+// Pointer-like access to one element stored as structure-of-arrays. Null if the element doesn't exist
+template<typename T>
+class SoAPointer final
+{
+public:
+	SoAPointer() = default;
+	SoAPointer(std::nullptr_t) {}
+	explicit SoAPointer(const typename T::SoARef& ref) : m_ref(ref) {}
+
+	explicit operator bool() const noexcept { return m_ref.has_value(); }
+	bool operator==(std::nullptr_t) const noexcept { return !m_ref.has_value(); }
+	bool operator!=(std::nullptr_t) const noexcept { return m_ref.has_value(); }
+
+	typename T::SoARef operator*() const { return *m_ref; }
+	const typename T::SoARef* operator->() const { return &*m_ref; }
+
+private:
+	std::optional<typename T::SoARef> m_ref;
+};
+
+
+/*
+	Dense storage of elements as structure-of-arrays, with one aligned array per field.
+	Offers the subset of std::vector's interface used by SparseSet, with index based operations in place of element references.
+	Field arrays are allocated from a memory resource, which is the default resource unless another one is passed.
+*/
+template<typename T>
+class SoAColumns final
+{
+	using Members = decltype(T::soaMembers());
+	static constexpr size_t FIELD_COUNT = std::tuple_size_v<Members>;
+
+	template<size_t I>
+	using FieldType = typename soa_field<std::tuple_element_t<I, Members>>::type;
+
+public:
+	// Alignment of every field array, which suits the widest vector registers
+	static constexpr size_t ALIGNMENT = 64;
+
+	SoAColumns() = default;
+	explicit SoAColumns(std::pmr::memory_resource* resource) : m_resource(resource) {}
+	SoAColumns(const SoAColumns& other) = delete;
+	~SoAColumns()
+	{
+		deallocate(std::make_index_sequence<FIELD_COUNT>());
+	}
+	SoAColumns& operator=(const SoAColumns& other) = delete;
+
+	template<typename... Args>
+	void emplace_back(Args&&... args)
+	{
+		if (m_size == m_capacity)
+		{
+			reserve(m_capacity > 0 ? m_capacity * 2 : 16);
+		}
+		store(m_size++, T(std::forward<Args>(args)...));
+	}
+	void pop_back() noexcept
+	{
+		m_size--;
+	}
+	void clear() noexcept
+	{
+		m_size = 0;
+	}
+	void reserve(const size_t capacity)
+	{
+		if (capacity > m_capacity)
+		{
+			reallocate(capacity, std::make_index_sequence<FIELD_COUNT>());
+		}
+	}
+	// Grows or shrinks to the size without writing the fields, which the caller must then fill
+	void resizeUninitialized(const size_t size)
+	{
+		reserve(size);
+		m_size = size;
+	}
+
+	// Copies every field of the element at src to the element at dst
+	void move(const size_t dst, const size_t src) noexcept
+	{
+		forEachField([dst, src](auto* field) { field[dst] = field[src]; });
+	}
+	void swap(const size_t lhs, const size_t rhs) noexcept
+	{
+		forEachField([lhs, rhs](auto* field) { std::swap(field[lhs], field[rhs]); });
+	}
+
+	typename T::SoARef ref(const size_t index) const noexcept
+	{
+		return std::apply([index](auto*... fields) { return typename T::SoARef{ fields[index]... }; }, m_fields);
+	}
+	typename T::SoASpan spans() const noexcept
+	{
+		return std::apply([](auto*... fields) { return typename T::SoASpan{ fields... }; }, m_fields);
+	}
+
+	// Gathers the fields of an element into an object
+	T load(const size_t index) const
+	{
+		T element{};
+		loadFields(element, index, std::make_index_sequence<FIELD_COUNT>());
+		return element;
+	}
+	// Scatters the fields of an object into an element
+	void store(const size_t index, const T& element) noexcept
+	{
+		storeFields(element, index, std::make_index_sequence<FIELD_COUNT>());
+	}
+
+	size_t size() const noexcept { return m_size; }
+	size_t capacity() const noexcept { return m_capacity; }
+	size_t byteSize() const noexcept { return elementSize(std::make_index_sequence<FIELD_COUNT>()) * m_capacity; }
+
+	// Reference proxy which can be built from an object stored elsewhere
+	static typename T::SoARef refOf(T& element) noexcept
+	{
+		return std::apply([&element](auto... members) { return typename T::SoARef{ (element.*members)... }; }, T::soaMembers());
+	}
+
+	// Calls f with a pointer to the first element of each field array, such as for copying whole arrays
+	template<typename Func>
+	void forEachField(Func f) const
+	{
+		std::apply([&f](auto*... fields) { (f(fields), ...); }, m_fields);
+	}
+
+private:
+
+	template<size_t... I>
+	void loadFields(T& element, const size_t index, std::index_sequence<I...>) const
+	{
+		((element.*std::get<I>(T::soaMembers()) = std::get<I>(m_fields)[index]), ...);
+	}
+	template<size_t... I>
+	void storeFields(const T& element, const size_t index, std::index_sequence<I...>) noexcept
+	{
+		((std::get<I>(m_fields)[index] = element.*std::get<I>(T::soaMembers())), ...);
+	}
+
+	template<size_t... I>
+	static constexpr size_t elementSize(std::index_sequence<I...>) noexcept
+	{
+		return (sizeof(FieldType<I>) + ...);
+	}
+
+	template<size_t... I>
+	void reallocate(const size_t capacity, std::index_sequence<I...>)
+	{
+		static_assert((std::is_trivially_copyable_v<FieldType<I>> && ...), "SoA fields must be trivially copyable");
+
+		std::tuple<FieldType<I>*...> fields{ static_cast<FieldType<I>*>(m_resource->allocate(sizeof(FieldType<I>) * capacity, ALIGNMENT))... };
+		if (m_size > 0)
+		{
+			(std::memcpy(std::get<I>(fields), std::get<I>(m_fields), sizeof(FieldType<I>) * m_size), ...);
+		}
+
+		deallocate(std::index_sequence<I...>());
+		m_fields = fields;
+		m_capacity = capacity;
+	}
+	template<size_t... I>
+	void deallocate(std::index_sequence<I...>) noexcept
+	{
+		if (m_capacity > 0)
+		{
+			(m_resource->deallocate(std::get<I>(m_fields), sizeof(FieldType<I>) * m_capacity, ALIGNMENT), ...);
+		}
+	}
+
+	template<size_t... I>
+	static auto makeFieldPointers(std::index_sequence<I...>) -> std::tuple<FieldType<I>*...>;
+
+private:
+	std::pmr::memory_resource* m_resource = std::pmr::get_default_resource();
+	decltype(makeFieldPointers(std::make_index_sequence<FIELD_COUNT>())) m_fields{};
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+};
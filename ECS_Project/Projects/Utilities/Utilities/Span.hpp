@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+/*
+	Non-owning view of contiguous elements, like a simplified std::span.
+	Can be made from any container with data() and size(), such as std::vector or std::array.
+*/
+template<typename T>
+class Span final
+{
+public:
+	Span() = default;
+	Span(T* data, const size_t size) noexcept : m_data(data), m_size(size) {}
+
+	// Spans of non-const elements convert to spans of const elements
+	template<typename U, typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+	Span(const Span<U>& other) noexcept : m_data(other.data()), m_size(other.size()) {}
+
+	template<typename Container, typename = std::enable_if_t<std::is_convertible_v<decltype(std::declval<Container&>().data()), T*>>>
+	Span(Container& container) noexcept : m_data(container.data()), m_size(container.size()) {}
+
+	T& operator[](const size_t index) const noexcept { return m_data[index]; }
+
+	T* data() const noexcept { return m_data; }
+	size_t size() const noexcept { return m_size; }
+	bool empty() const noexcept { return m_size == 0; }
+
+	T* begin() const noexcept { return m_data; }
+	T* end() const noexcept { return m_data + m_size; }
+
+	// Elements [offset, offset + count)
+	Span subspan(const size_t offset, const size_t count) const noexcept { return Span(m_data + offset, count); }
+
+private:
+	T* m_data = nullptr;
+	size_t m_size = 0;
+};
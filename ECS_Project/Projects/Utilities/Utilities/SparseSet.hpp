@@ -1,11 +1,26 @@
 #pragma once
 #include <vector>
+#include <array>
+#include <memory_resource>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include "SoA.hpp"
+#include "Span.hpp"
+#include "Serialization/BinaryWriter.hpp"
+#include "Serialization/BinaryReader.hpp"
 
 /*
 	Storage for elements assigned to a certain index.
 	Elements will be stored sequentially and densely.
-	Indices will be stored sparsely.
+	Indices will be stored sparsely, in pages which are only allocated while any of their indices are in use.
 	Removing or getting elements is O(1). Adding is O(1) except when a reallocation is required.
+	Types declared with MAKE_SOA are stored as structure-of-arrays, and are accessed through SoAPointer and T::SoARef.
+	Everything is allocated from a memory resource, which is the default resource unless another one is passed.
+	Elements can be stamped with the tick at which they were added and last changed, once tick tracking has been enabled.
+	Sets of serializable types can be saved as raw arrays and loaded back with one copy per array, see save and load.
 */
 
 template<typename T>
@@ -14,9 +29,41 @@ class SparseSet final
 public:
 	using IndexType = int;
 
-	SparseSet() = default;
+	// Number of indices per page of the sparse side
+	static constexpr size_t PAGE_SIZE = 4096;
+
+	static constexpr bool IS_SOA = has_soa_layout<T>::value;
+	static constexpr bool IS_SERIALIZABLE = IS_SOA || Serialization::is_serializable<T>::value;
+	using Storage = std::conditional_t<IS_SOA, SoAColumns<T>, std::pmr::vector<T>>;
+	using Pointer = std::conditional_t<IS_SOA, SoAPointer<T>, T*>;
+
+	using Tick = std::uint32_t;
+
+	// Ticks at which an element was added and last changed
+	struct ElementTicks
+	{
+		Tick added;
+		Tick changed;
+	};
+
+	SparseSet() : SparseSet(std::pmr::get_default_resource()) {}
+	explicit SparseSet(std::pmr::memory_resource* resource) :
+		m_elements(resource),
+		m_elemToIndex(resource),
+		m_pages(resource),
+		m_pageUsage(resource),
+		m_ticks(resource),
+		m_resource(resource)
+	{
+	}
 	SparseSet(const SparseSet& other) = delete;
-	~SparseSet() = default;
+	~SparseSet()
+	{
+		for (IndexType* page : m_pages)
+		{
+			releasePage(page);
+		}
+	}
 
 	SparseSet& operator=(const SparseSet& other) = delete;
 
@@ -32,7 +79,7 @@ public:
 		expandToFit(index);
 
 		// Element on this index already exists
-		if (m_indexToElem[index] != -1)
+		if (link(index) != -1)
 		{
 			return true;
 		}
@@ -41,6 +88,56 @@ public:
 
 		return true;
 	}
+	// Adds an element to each of the indices, where elementAt(i) returns the element of the i:th index
+	// Storage is reserved once and the sparse side is grown once, instead of per element
+	// Indices which are negative or already have an element are skipped. Returns the number of added elements
+	template<typename ElementFunc>
+	size_t addMany(Span<const IndexType> indices, ElementFunc elementAt)
+	{
+		if (indices.empty())
+		{
+			return 0;
+		}
+
+		const IndexType highestIndex = *std::max_element(indices.begin(), indices.end());
+		if (highestIndex < 0)
+		{
+			return 0;
+		}
+		growPageTable(highestIndex);
+
+		const size_t neededCapacity = m_elements.size() + indices.size();
+		if (neededCapacity > m_elements.capacity())
+		{
+			// Grow geometrically, so that repeated bulk adds don't reallocate every time
+			const size_t capacity = std::max(neededCapacity, m_elements.capacity() * 2);
+			m_elements.reserve(capacity);
+			m_elemToIndex.reserve(capacity);
+			if (m_clock)
+			{
+				m_ticks.reserve(capacity);
+			}
+		}
+
+		const size_t oldSize = m_elements.size();
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			const IndexType index = indices[i];
+			if (index < 0)
+			{
+				continue;
+			}
+
+			// The page table fits every index already, and only the page of the index may need to be allocated
+			allocatePage(static_cast<size_t>(index) / PAGE_SIZE);
+			if (link(index) == -1)
+			{
+				addAndLinkElement(index, elementAt(i));
+			}
+		}
+		return m_elements.size() - oldSize;
+	}
+
 	bool remove(IndexType index)
 	{
 		// Remove only if index is valid and element exists
@@ -51,92 +148,488 @@ public:
 
 		// Indices which will be linked after removal of element
 		const IndexType movedLinkIndex = m_elemToIndex.back();
-		const IndexType movedElemIndex = m_indexToElem[index];
+		const IndexType movedElemIndex = link(index);
 
 		// Move element and redirect links
-		m_elements[movedElemIndex] = m_elements.back();
+		if (static_cast<size_t>(movedElemIndex) != m_elements.size() - 1)
+		{
+			relocate(static_cast<size_t>(movedElemIndex), m_elements.size() - 1);
+			if (m_clock)
+			{
+				m_ticks[movedElemIndex] = m_ticks.back();
+			}
+		}
 		m_elemToIndex[movedElemIndex] = movedLinkIndex;
-		m_indexToElem[movedLinkIndex] = movedElemIndex;
+		link(movedLinkIndex) = movedElemIndex;
 
 		// Remove last element and remove links
 		m_elements.pop_back();
 		m_elemToIndex.pop_back();
-		m_indexToElem[index] = -1;
+		if (m_clock)
+		{
+			m_ticks.pop_back();
+		}
+		unlink(index);
+
+		return true;
+	}
+	bool has(IndexType index) const
+	{
+		// Negative indices wrap around to a page which can't exist
+		const size_t page = static_cast<size_t>(index) / PAGE_SIZE;
+		return (page < m_pages.size() && m_pages[page][static_cast<size_t>(index) % PAGE_SIZE] != -1);
+	}
+	Pointer get(IndexType index)
+	{
+		if (!has(index))
+		{
+			return nullptr;
+		}
+
+		if constexpr (IS_SOA)
+		{
+			return Pointer(m_elements.ref(link(index)));
+		}
+		else
+		{
+			return &m_elements[link(index)];
+		}
+	}
+
+	// Element of an index which is known to have one, without checking it
+	Pointer getExisting(IndexType index)
+	{
+		if constexpr (IS_SOA)
+		{
+			return Pointer(m_elements.ref(link(index)));
+		}
+		else
+		{
+			return &m_elements[link(index)];
+		}
+	}
 
-		//// Indices which will be linked after removal of element
-		//const IndexType movedElemIndex = m_indexToElem[index];
-		//const IndexType movedKeyIndex = m_elements[movedElemIndex]
-		//const IndexType movedLinkIndex = m_elemToIndex.back();
+	// Position of an index's element within the dense storage, or -1 if it has no element
+	IndexType denseIndexOf(IndexType index) const
+	{
+		return (has(index) ? m_pages[static_cast<size_t>(index) / PAGE_SIZE][static_cast<size_t>(index) % PAGE_SIZE] : -1);
+	}
 
-		//// Move element and redirect links
-		//m_elements[movedElemIndex] = m_elements.back();
-		//m_elemToIndex[movedElemIndex] = movedLinkIndex;
-		//m_indexToElem[movedLinkIndex] = movedElemIndex;
+	// Swaps the dense positions of two elements, keeping their indices linked
+	void swapDense(IndexType lhs, IndexType rhs)
+	{
+		if (lhs == rhs)
+		{
+			return;
+		}
 
-		//// Remove last element and remove links
-		//m_elements.pop_back();
-		//m_elemToIndex.pop_back();
-		//m_indexToElem[index] = -1;
+		if constexpr (IS_SOA)
+		{
+			m_elements.swap(lhs, rhs);
+		}
+		else
+		{
+			std::swap(m_elements[lhs], m_elements[rhs]);
+		}
+		std::swap(m_elemToIndex[lhs], m_elemToIndex[rhs]);
+		link(m_elemToIndex[lhs]) = lhs;
+		link(m_elemToIndex[rhs]) = rhs;
+		if (m_clock)
+		{
+			std::swap(m_ticks[lhs], m_ticks[rhs]);
+		}
+	}
 
-		return true;
+	// Starts stamping elements with the tick read from the clock whenever they're added or marked as changed
+	// Elements which already exist count as added and changed at the current tick. The clock must outlive the set
+	void trackTicks(const Tick* clock)
+	{
+		if (!m_clock)
+		{
+			m_clock = clock;
+			m_ticks.assign(m_elements.size(), { *clock, *clock });
+		}
 	}
-	bool has(IndexType index) const
+	bool tracksTicks() const noexcept
+	{
+		return (m_clock != nullptr);
+	}
+	// Stamps the element of an index with the current tick, if ticks are tracked
+	void markChanged(IndexType index)
 	{
-		return ((index >= 0 && index < static_cast<IndexType>(m_indexToElem.size())) && m_indexToElem[index] != -1);
+		if (m_clock && has(index))
+		{
+			m_ticks[link(index)].changed = *m_clock;
+		}
+	}
+	// Stamps every element with the current tick, if ticks are tracked
+	void markAllChanged()
+	{
+		if (m_clock)
+		{
+			for (ElementTicks& ticks : m_ticks)
+			{
+				ticks.changed = *m_clock;
+			}
+		}
 	}
-	T* get(IndexType index)
+	// Ticks of the element at a dense position. Only valid while ticks are tracked
+	const ElementTicks& ticksAt(size_t denseIndex) const
 	{
-		return (has(index) ? &m_elements[m_indexToElem[index]] : nullptr);
+		return m_ticks[denseIndex];
 	}
 	
 
-	std::vector<T>& getElements() noexcept
+	// Moves every element to a new index, where newIndexOf[index] is the new index of the element at index
+	// Every index in use must be mapped to a unique, valid index. The dense order is kept, and the sparse side is rebuilt to fit the new indices
+	void remap(Span<const IndexType> newIndexOf)
 	{
-		return m_elements;
+		for (IndexType& index : m_elemToIndex)
+		{
+			index = newIndexOf[static_cast<size_t>(index)];
+		}
+
+		for (IndexType* page : m_pages)
+		{
+			releasePage(page);
+		}
+		m_pages.clear();
+		m_pageUsage.clear();
+
+		if (!m_elemToIndex.empty())
+		{
+			expandToFit(*std::max_element(m_elemToIndex.begin(), m_elemToIndex.end()));
+		}
+		for (size_t i = 0; i < m_elemToIndex.size(); i++)
+		{
+			const IndexType index = m_elemToIndex[i];
+			expandToFit(index);
+			link(index) = static_cast<IndexType>(i);
+			m_pageUsage[static_cast<size_t>(index) / PAGE_SIZE]++;
+		}
+		m_pages.shrink_to_fit();
+		m_pageUsage.shrink_to_fit();
 	}
-	const std::vector<IndexType>& getIndexToElem() const noexcept
+
+	Storage& getElements() noexcept
 	{
-		return m_indexToElem;
+		return m_elements;
 	}
-	const std::vector<IndexType>& getElemToIndex() const noexcept
+	const std::pmr::vector<IndexType>& getElemToIndex() const noexcept
 	{
 		return m_elemToIndex;
 	}
 
+	// Sorts the elements by index in ascending order, in linear time
+	// The indices are radix sorted, after which every element is moved at most twice to reach its place
 	void sort()
 	{
-		// Shell sort the elements by index in ascending order
-		const size_t size = m_elements.size();
-		for (size_t gap = size / 2; gap > 0; gap /= 2)
+		if (std::is_sorted(m_elemToIndex.begin(), m_elemToIndex.end()))
+		{
+			return;
+		}
+
+		std::vector<IndexType> order = sortedOrder();
+		if (m_clock)
+		{
+			std::pmr::vector<ElementTicks> ticks(m_ticks.size(), m_ticks.get_allocator());
+			for (size_t i = 0; i < order.size(); i++)
+			{
+				ticks[i] = m_ticks[order[i]];
+			}
+			m_ticks.swap(ticks);
+		}
+		applyOrder(order);
+
+		// Redirect the links of every moved element
+		for (size_t i = 0; i < m_elemToIndex.size(); i++)
+		{
+			link(m_elemToIndex[i]) = static_cast<IndexType>(i);
+		}
+	}
+
+	// Writes the dense elements, their indices and the used pages of the sparse side as raw arrays
+	// Elements are written through their serialization hooks if they have any, otherwise as bytes. Ticks aren't saved
+	void save(Serialization::BinaryWriter& writer) const
+	{
+		static_assert(IS_SERIALIZABLE, "Elements must be trivially copyable or have serialization hooks");
+
+		writer.write(static_cast<std::uint64_t>(m_elements.size()));
+		writer.write(static_cast<std::uint64_t>(m_pages.size()));
+
+		if constexpr (IS_SOA)
+		{
+			m_elements.forEachField([this, &writer](auto* field) { writer.writeBytes(field, sizeof(*field) * m_elements.size(), alignof(decltype(*field))); });
+		}
+		else if constexpr (Serialization::has_serialization_hooks<T>::value)
+		{
+			for (const T& element : m_elements)
+			{
+				element.save(writer);
+			}
+		}
+		else
+		{
+			writer.writeBytes(m_elements.data(), sizeof(T) * m_elements.size(), alignof(T));
+		}
+
+		writer.writeBytes(m_elemToIndex.data(), sizeof(IndexType) * m_elemToIndex.size(), alignof(IndexType));
+		writer.writeBytes(m_pageUsage.data(), sizeof(IndexType) * m_pageUsage.size(), alignof(IndexType));
+		for (size_t page = 0; page < m_pages.size(); page++)
 		{
-			for (size_t i = gap; i < size; i++)
+			if (m_pageUsage[page] > 0)
 			{
-				IndexType tempIndexToElem = m_indexToElem[i];
-				IndexType tempElemToIndex = m_elemToIndex[i];
-				T tempElem = m_elements[i];
-				
-				size_t j;
+				writer.writeBytes(m_pages[page], sizeof(IndexType) * PAGE_SIZE, alignof(IndexType));
+			}
+		}
+	}
+	// Reads what save wrote into an empty set. Arrays of elements without hooks, indices and pages are copied as a whole, without visiting each element
+	// The data is trusted to come from save, and only its sizes are checked. Returns false and leaves the set empty if the set wasn't empty or the data ended early
+	bool load(Serialization::BinaryReader& reader)
+	{
+		static_assert(IS_SERIALIZABLE, "Elements must be trivially copyable or have serialization hooks");
+
+		if (m_elements.size() != 0)
+		{
+			return false;
+		}
+		// Pages of removed elements are kept, and are replaced by the loaded ones
+		clear();
+
+		std::uint64_t count = 0;
+		std::uint64_t pageCount = 0;
+		reader.read(count);
+		reader.read(pageCount);
+		if (count > static_cast<std::uint64_t>(std::numeric_limits<IndexType>::max()) || pageCount > static_cast<std::uint64_t>(std::numeric_limits<IndexType>::max()) / PAGE_SIZE + 1)
+		{
+			reader.fail();
+		}
 
-				for (j = i; j >= gap && m_elemToIndex[j - gap] > tempElemToIndex; j -= gap)
+		if constexpr (IS_SOA)
+		{
+			m_elements.resizeUninitialized(reader.isGood() ? static_cast<size_t>(count) : 0);
+			m_elements.forEachField([&reader, count](auto* field)
+			{
+				const void* data = reader.readBytes(sizeof(*field) * static_cast<size_t>(count), alignof(decltype(*field)));
+				if (data && count > 0)
 				{
-					m_indexToElem[j] = m_indexToElem[j - gap];
-					m_elemToIndex[j] = m_elemToIndex[j - gap];
-					m_elements[j] = m_elements[j - gap];
+					std::memcpy(field, data, sizeof(*field) * static_cast<size_t>(count));
 				}
+			});
+		}
+		else if constexpr (Serialization::has_serialization_hooks<T>::value)
+		{
+			m_elements.reserve(reader.isGood() ? static_cast<size_t>(count) : 0);
+			for (std::uint64_t i = 0; i < count && reader.isGood(); i++)
+			{
+				m_elements.emplace_back(T::load(reader));
+			}
+		}
+		else
+		{
+			if (const T* elements = static_cast<const T*>(readArray(reader, sizeof(T), alignof(T), count)))
+			{
+				m_elements.assign(elements, elements + count);
+			}
+		}
+
+		if (const IndexType* indices = static_cast<const IndexType*>(readArray(reader, sizeof(IndexType), alignof(IndexType), count)))
+		{
+			m_elemToIndex.assign(indices, indices + count);
+		}
+		if (const IndexType* usage = static_cast<const IndexType*>(readArray(reader, sizeof(IndexType), alignof(IndexType), pageCount)))
+		{
+			m_pageUsage.assign(usage, usage + pageCount);
+		}
+
+		// Every element must be linked from exactly one used page
+		std::uint64_t linkCount = 0;
+		for (const IndexType usage : m_pageUsage)
+		{
+			linkCount += static_cast<std::uint64_t>(std::max(usage, 0));
+		}
+		if (linkCount != count)
+		{
+			reader.fail();
+		}
 
-				m_indexToElem[j] = tempIndexToElem;
-				m_elemToIndex[j] = tempElemToIndex;
-				m_elements[j] = tempElem;
+		m_pages.assign(reader.isGood() ? static_cast<size_t>(pageCount) : 0, emptyPage());
+		for (size_t page = 0; page < m_pages.size() && reader.isGood(); page++)
+		{
+			if (m_pageUsage[page] > 0)
+			{
+				const void* links = reader.readBytes(sizeof(IndexType) * PAGE_SIZE, alignof(IndexType));
+				if (links)
+				{
+					m_pages[page] = static_cast<IndexType*>(m_resource->allocate(sizeof(IndexType) * PAGE_SIZE, alignof(IndexType)));
+					m_allocatedPageCount++;
+					std::memcpy(m_pages[page], links, sizeof(IndexType) * PAGE_SIZE);
+				}
+			}
+		}
+
+		if (!reader.isGood() || m_elements.size() != count)
+		{
+			clear();
+			return false;
+		}
+
+		// Loaded elements count as added and changed at the current tick
+		if (m_clock)
+		{
+			m_ticks.assign(m_elements.size(), { *m_clock, *m_clock });
+		}
+		return true;
+	}
+
+	// Writes the elements changed after the tick and their indices, which loadChanges adds or overwrites. Requires ticks to be tracked
+	void saveChanges(Serialization::BinaryWriter& writer, const Tick since) const
+	{
+		static_assert(IS_SERIALIZABLE, "Elements must be trivially copyable or have serialization hooks");
+
+		std::vector<size_t> positions;
+		for (size_t i = 0; i < m_ticks.size(); i++)
+		{
+			if (m_ticks[i].changed > since)
+			{
+				positions.push_back(i);
+			}
+		}
+
+		writer.write(static_cast<std::uint64_t>(positions.size()));
+		writer.align(alignof(IndexType));
+		for (const size_t position : positions)
+		{
+			writer.writeBytes(&m_elemToIndex[position], sizeof(IndexType));
+		}
+
+		// Aligning once keeps every element aligned, as sizes are multiples of alignments
+		if constexpr (IS_SOA)
+		{
+			m_elements.forEachField([&writer, &positions](auto* field)
+			{
+				writer.align(alignof(decltype(*field)));
+				for (const size_t position : positions)
+				{
+					writer.writeBytes(&field[position], sizeof(*field));
+				}
+			});
+		}
+		else if constexpr (Serialization::has_serialization_hooks<T>::value)
+		{
+			for (const size_t position : positions)
+			{
+				m_elements[position].save(writer);
+			}
+		}
+		else
+		{
+			writer.align(alignof(T));
+			for (const size_t position : positions)
+			{
+				writer.writeBytes(&m_elements[position], sizeof(T));
+			}
+		}
+	}
+	// Adds or overwrites the elements written by saveChanges, which are stamped as changed. Returns false if the data ended early
+	bool loadChanges(Serialization::BinaryReader& reader)
+	{
+		static_assert(IS_SERIALIZABLE, "Elements must be trivially copyable or have serialization hooks");
+
+		std::uint64_t count = 0;
+		reader.read(count);
+		const IndexType* indices = static_cast<const IndexType*>(readArray(reader, sizeof(IndexType), alignof(IndexType), count));
+		if (!indices)
+		{
+			return false;
+		}
+
+		if constexpr (IS_SOA)
+		{
+			// Elements are created first, after which each field is copied into place
+			for (std::uint64_t i = 0; i < count; i++)
+			{
+				add(indices[i]);
+			}
+			m_elements.forEachField([this, &reader, indices, count](auto* field)
+			{
+				const unsigned char* values = static_cast<const unsigned char*>(readArray(reader, sizeof(*field), alignof(decltype(*field)), count));
+				for (std::uint64_t i = 0; values && i < count; i++)
+				{
+					std::memcpy(&field[link(indices[i])], values + sizeof(*field) * i, sizeof(*field));
+				}
+			});
+		}
+		else if constexpr (Serialization::has_serialization_hooks<T>::value)
+		{
+			for (std::uint64_t i = 0; i < count && reader.isGood(); i++)
+			{
+				T element = T::load(reader);
+				if (has(indices[i]))
+				{
+					m_elements[link(indices[i])] = std::move(element);
+				}
+				else
+				{
+					add(indices[i], std::move(element));
+				}
+			}
+		}
+		else
+		{
+			const T* elements = static_cast<const T*>(readArray(reader, sizeof(T), alignof(T), count));
+			for (std::uint64_t i = 0; elements && i < count; i++)
+			{
+				if (has(indices[i]))
+				{
+					std::memcpy(static_cast<void*>(&m_elements[link(indices[i])]), static_cast<const void*>(&elements[i]), sizeof(T));
+				}
+				else
+				{
+					add(indices[i], elements[i]);
+				}
+			}
+		}
+
+		if (m_clock)
+		{
+			for (std::uint64_t i = 0; i < count; i++)
+			{
+				markChanged(indices[i]);
 			}
 		}
+		return reader.isGood();
+	}
+
+	// Removes every element and releases the sparse side
+	void clear()
+	{
+		for (IndexType* page : m_pages)
+		{
+			releasePage(page);
+		}
+		m_pages.clear();
+		m_pageUsage.clear();
+		m_elements.clear();
+		m_elemToIndex.clear();
+		m_ticks.clear();
 	}
 
 	size_t byteSize() const noexcept
 	{
 		size_t size = 0;
 		size += sizeof(*this);
-		size += sizeof(T) * m_elements.capacity();
-		size += sizeof(IndexType) * (m_indexToElem.capacity() + m_elemToIndex.capacity());
+		if constexpr (IS_SOA)
+		{
+			size += m_elements.byteSize();
+		}
+		else
+		{
+			size += sizeof(T) * m_elements.capacity();
+		}
+		size += sizeof(IndexType) * (m_elemToIndex.capacity() + PAGE_SIZE * m_allocatedPageCount);
+		size += sizeof(IndexType*) * m_pages.capacity() + sizeof(IndexType) * m_pageUsage.capacity();
+		size += sizeof(ElementTicks) * m_ticks.capacity();
 		return size;
 	}
 	size_t size() const noexcept
@@ -145,12 +638,174 @@ public:
 	}
 
 private:
+	// Dense position of the element which belongs at each position, found by a least significant digit radix sort of the indices
+	std::vector<IndexType> sortedOrder() const
+	{
+		constexpr size_t DIGIT_BITS = 11;
+		constexpr size_t BUCKET_COUNT = size_t(1) << DIGIT_BITS;
+
+		// Each entry holds an index in its upper half and a dense position in its lower half
+		const size_t size = m_elemToIndex.size();
+		std::vector<std::uint64_t> entries(size);
+		std::vector<std::uint64_t> sorted(size);
+		for (size_t i = 0; i < size; i++)
+		{
+			entries[i] = (static_cast<std::uint64_t>(m_elemToIndex[i]) << 32) | i;
+		}
+
+		// Only as many digits as the highest index needs are sorted
+		const std::uint64_t highestIndex = static_cast<std::uint64_t>(*std::max_element(m_elemToIndex.begin(), m_elemToIndex.end()));
+		for (size_t shift = 32; shift == 32 || (highestIndex >> (shift - 32)) > 0; shift += DIGIT_BITS)
+		{
+			std::array<size_t, BUCKET_COUNT> offsets{};
+			for (const std::uint64_t entry : entries)
+			{
+				offsets[(entry >> shift) & (BUCKET_COUNT - 1)]++;
+			}
+			size_t offset = 0;
+			for (size_t& bucket : offsets)
+			{
+				const size_t count = bucket;
+				bucket = offset;
+				offset += count;
+			}
+			for (const std::uint64_t entry : entries)
+			{
+				sorted[offsets[(entry >> shift) & (BUCKET_COUNT - 1)]++] = entry;
+			}
+			entries.swap(sorted);
+		}
+
+		std::vector<IndexType> order(size);
+		for (size_t i = 0; i < size; i++)
+		{
+			order[i] = static_cast<IndexType>(entries[i] & 0xFFFFFFFFu);
+		}
+		return order;
+	}
+
+	// Moves the element at order[i] to position i for every position, following each cycle of the permutation once
+	void applyOrder(std::vector<IndexType>& order)
+	{
+		for (size_t start = 0; start < order.size(); start++)
+		{
+			if (order[start] == static_cast<IndexType>(start))
+			{
+				continue;
+			}
+
+			// The first element of the cycle is held aside while the others are shifted into place
+			auto held = takeElement(start);
+			const IndexType heldIndex = m_elemToIndex[start];
+
+			size_t position = start;
+			while (static_cast<size_t>(order[position]) != start)
+			{
+				const size_t source = static_cast<size_t>(order[position]);
+				relocate(position, source);
+				m_elemToIndex[position] = m_elemToIndex[source];
+				order[position] = static_cast<IndexType>(position);
+				position = source;
+			}
+			putElement(position, std::move(held));
+			m_elemToIndex[position] = heldIndex;
+			order[position] = static_cast<IndexType>(position);
+		}
+	}
+
+	// Moves the element at src to dst, where src is left to be overwritten
+	void relocate(const size_t dst, const size_t src)
+	{
+		if constexpr (IS_SOA)
+		{
+			m_elements.move(dst, src);
+		}
+		else if constexpr (std::is_trivially_copyable_v<T>)
+		{
+			std::memcpy(static_cast<void*>(&m_elements[dst]), static_cast<const void*>(&m_elements[src]), sizeof(T));
+		}
+		else
+		{
+			m_elements[dst] = std::move(m_elements[src]);
+		}
+	}
+	T takeElement(const size_t position)
+	{
+		if constexpr (IS_SOA)
+		{
+			return m_elements.load(position);
+		}
+		else
+		{
+			return std::move(m_elements[position]);
+		}
+	}
+	void putElement(const size_t position, T&& element)
+	{
+		if constexpr (IS_SOA)
+		{
+			m_elements.store(position, element);
+		}
+		else
+		{
+			m_elements[position] = std::move(element);
+		}
+	}
+
+	// Array of count elements of the given size, or null if the reader doesn't hold that many
+	static const void* readArray(Serialization::BinaryReader& reader, const size_t size, const size_t alignment, const std::uint64_t count)
+	{
+		if (count > static_cast<std::uint64_t>(SIZE_MAX / size))
+		{
+			reader.fail();
+			return nullptr;
+		}
+		return reader.readBytes(size * static_cast<size_t>(count), alignment);
+	}
+
+	// Makes sure the page of an index exists and is writable
 	void expandToFit(IndexType index)
 	{
-		size_t index_ = static_cast<size_t>(index);
-		if (index_ >= m_indexToElem.size())
+		growPageTable(index);
+		allocatePage(static_cast<size_t>(index) / PAGE_SIZE);
+	}
+	// Makes sure the page table has an entry for the page of an index
+	void growPageTable(IndexType index)
+	{
+		const size_t page = static_cast<size_t>(index) / PAGE_SIZE;
+		if (page >= m_pages.size())
 		{
-			m_indexToElem.resize(index_ + 1, -1);
+			m_pages.resize(page + 1, emptyPage());
+			m_pageUsage.resize(page + 1, 0);
+		}
+	}
+	// Makes sure a page in the page table is writable
+	void allocatePage(const size_t page)
+	{
+		if (m_pages[page] == emptyPage())
+		{
+			m_pages[page] = static_cast<IndexType*>(m_resource->allocate(sizeof(IndexType) * PAGE_SIZE, alignof(IndexType)));
+			std::fill(m_pages[page], m_pages[page] + PAGE_SIZE, -1);
+			m_allocatedPageCount++;
+		}
+	}
+
+	// Element index of an index. The page of the index is assumed to be writable
+	IndexType& link(IndexType index)
+	{
+		return m_pages[static_cast<size_t>(index) / PAGE_SIZE][static_cast<size_t>(index) % PAGE_SIZE];
+	}
+
+	// Removes the link of an index and releases its page if it became unused
+	void unlink(IndexType index)
+	{
+		const size_t page = static_cast<size_t>(index) / PAGE_SIZE;
+		link(index) = -1;
+
+		if (--m_pageUsage[page] == 0)
+		{
+			releasePage(m_pages[page]);
+			m_pages[page] = emptyPage();
 		}
 	}
 
@@ -160,12 +815,40 @@ private:
 		m_elements.emplace_back(std::forward<Args>(args)...);
 
 		// Index is assumed to be valid
-		m_indexToElem[index] = static_cast<IndexType>(m_elements.size()) - 1;
+		link(index) = static_cast<IndexType>(m_elements.size()) - 1;
+		m_pageUsage[static_cast<size_t>(index) / PAGE_SIZE]++;
 		m_elemToIndex.emplace_back(index);
+		if (m_clock)
+		{
+			m_ticks.push_back({ *m_clock, *m_clock });
+		}
+	}
+
+	void releasePage(IndexType* page)
+	{
+		if (page != emptyPage())
+		{
+			m_resource->deallocate(page, sizeof(IndexType) * PAGE_SIZE, alignof(IndexType));
+			m_allocatedPageCount--;
+		}
+	}
+
+	// Shared page without any links, used by every unallocated page. It's never written to
+	static IndexType* emptyPage() noexcept
+	{
+		static std::array<IndexType, PAGE_SIZE> s_emptyPage = []() { std::array<IndexType, PAGE_SIZE> page{}; page.fill(-1); return page; }();
+		return s_emptyPage.data();
 	}
 
 private:
-	std::vector<T> m_elements;				// size = nr of elements
-	std::vector<IndexType> m_elemToIndex;	// size = nr of elements
-	std::vector<IndexType> m_indexToElem;	// size = highest index used
+	Storage m_elements;						// size = nr of elements
+	std::pmr::vector<IndexType> m_elemToIndex;	// size = nr of elements
+	std::pmr::vector<IndexType*> m_pages;		// size = highest index used / PAGE_SIZE
+	std::pmr::vector<IndexType> m_pageUsage;	// size = highest index used / PAGE_SIZE
+	std::pmr::vector<ElementTicks> m_ticks;		// size = nr of elements while ticks are tracked, otherwise empty
+	size_t m_allocatedPageCount = 0;
+	std::pmr::memory_resource* m_resource;
+
+	// Current tick, or null if ticks aren't tracked
+	const Tick* m_clock = nullptr;
 };
\ No newline at end of file
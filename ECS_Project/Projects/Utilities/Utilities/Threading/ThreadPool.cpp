@@ -0,0 +1,183 @@
+#include "pch_Utilities.hpp"
+#include "ThreadPool.hpp"
+
+namespace Threading
+{
+	namespace
+	{
+		// Pool and queue of the current thread, if it's a worker
+		thread_local const ThreadPool* t_pool = nullptr;
+		thread_local size_t t_queueIndex = 0;
+	}
+
+	ThreadPool::ThreadPool(size_t threadCount)
+	{
+		if (threadCount == 0)
+		{
+			const size_t hardwareThreads = std::thread::hardware_concurrency();
+			threadCount = (hardwareThreads > 1 ? hardwareThreads - 1 : 1);
+		}
+
+		for (size_t i = 0; i < threadCount + 1; i++)
+		{
+			m_queues.push_back(std::make_unique<Queue>());
+		}
+
+		m_workers.reserve(threadCount);
+		for (size_t i = 0; i < threadCount; i++)
+		{
+			m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+		}
+	}
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_isStopping = true;
+		}
+		m_wakeUp.notify_all();
+
+		for (std::thread& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	ThreadPool& ThreadPool::getDefault()
+	{
+		static ThreadPool s_instance;
+		return s_instance;
+	}
+
+	void ThreadPool::runJob(Job& job, const size_t count)
+	{
+		const size_t queueIndex = currentQueueIndex();
+		execute({ &job, 0, count }, queueIndex);
+
+		// Help with any queued task until every part of this job is done
+		Task task;
+		while (job.remaining.load(std::memory_order_acquire) > 0)
+		{
+			if (popLocal(task, queueIndex) || steal(task, queueIndex))
+			{
+				execute(task, queueIndex);
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		// Every queued half points at the job, so it's only thrown once none of them are left
+		if (job.hasFailed.load(std::memory_order_acquire))
+		{
+			std::rethrow_exception(job.exception);
+		}
+	}
+	void ThreadPool::workerLoop(const size_t queueIndex)
+	{
+		t_pool = this;
+		t_queueIndex = queueIndex;
+
+		Task task;
+		while (true)
+		{
+			if (popLocal(task, queueIndex) || steal(task, queueIndex))
+			{
+				execute(task, queueIndex);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(m_sleepMutex);
+			m_wakeUp.wait(lock, [this]() { return m_isStopping || m_queuedTasks.load(std::memory_order_acquire) > 0; });
+			if (m_isStopping)
+			{
+				return;
+			}
+		}
+	}
+	void ThreadPool::execute(Task task, const size_t queueIndex) noexcept
+	{
+		Job& job = *task.job;
+		try
+		{
+			while (task.end - task.begin > job.grainSize && !job.hasFailed.load(std::memory_order_relaxed))
+			{
+				const size_t middle = task.begin + (task.end - task.begin) / 2;
+				push({ &job, middle, task.end }, queueIndex);
+				task.end = middle;
+			}
+
+			if (!job.hasFailed.load(std::memory_order_relaxed))
+			{
+				job.run(job.context, task.begin, task.end);
+			}
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(job.exceptionMutex);
+			if (!job.hasFailed.load(std::memory_order_relaxed))
+			{
+				job.exception = std::current_exception();
+				job.hasFailed.store(true, std::memory_order_release);
+			}
+		}
+
+		// Halves which were pushed are subtracted by whoever runs them, and the rest of the range is subtracted here even if it failed
+		job.remaining.fetch_sub(task.end - task.begin, std::memory_order_acq_rel);
+	}
+
+	void ThreadPool::push(const Task& task, const size_t queueIndex)
+	{
+		{
+			Queue& queue = *m_queues[queueIndex];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back(task);
+		}
+
+		{
+			// Incremented under the sleep mutex to make sure no worker misses the wake up
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+			m_queuedTasks.fetch_add(1, std::memory_order_release);
+		}
+		m_wakeUp.notify_one();
+	}
+	bool ThreadPool::popLocal(Task& task, const size_t queueIndex)
+	{
+		// The most recently split task is the smallest one, and the most likely to still be in cache
+		Queue& queue = *m_queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+		{
+			return false;
+		}
+
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		m_queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	bool ThreadPool::steal(Task& task, const size_t queueIndex)
+	{
+		// The oldest task of another queue is the largest one
+		const size_t queueCount = m_queues.size();
+		for (size_t i = 1; i < queueCount; i++)
+		{
+			Queue& queue = *m_queues[(queueIndex + i) % queueCount];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+				m_queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	size_t ThreadPool::currentQueueIndex() const noexcept
+	{
+		return (t_pool == this ? t_queueIndex : m_queues.size() - 1);
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Threading
+{
+	/*
+		Pool of worker threads which run ranges of work, with work stealing.
+
+		Each worker has its own queue of tasks. A task covering more than the grain size is split in half,
+		where the second half is queued for any worker to steal and the first half is split further.
+		Idle workers steal from the front of other queues, which is where the largest remaining tasks are.
+
+		If func throws, the remaining chunks of the job are skipped, and the first exception is rethrown by parallelFor once every queued chunk is done.
+
+		Any type with a parallelFor(count, grainSize, func) function can be used as an executor in place of this pool.
+	*/
+	class ThreadPool final
+	{
+	public:
+		// Zero threads uses one per hardware thread, minus the calling thread
+		explicit ThreadPool(size_t threadCount = 0);
+		ThreadPool(const ThreadPool& other) = delete;
+		~ThreadPool();
+		ThreadPool& operator=(const ThreadPool& other) = delete;
+
+		// Calls func(begin, end) for chunks of [0, count) of at most grainSize elements, and returns when all are done
+		// The calling thread helps out while waiting, meaning that this can be called from within a task
+		template<typename Func>
+		void parallelFor(const size_t count, const size_t grainSize, Func&& func)
+		{
+			if (count == 0)
+			{
+				return;
+			}
+
+			auto run = [](void* context, const size_t begin, const size_t end) { (*static_cast<std::remove_reference_t<Func>*>(context))(begin, end); };
+
+			Job job;
+			job.run = run;
+			job.context = const_cast<void*>(static_cast<const void*>(&func));
+			job.grainSize = (grainSize > 0 ? grainSize : 1);
+			job.remaining.store(count, std::memory_order_relaxed);
+
+			runJob(job, count);
+		}
+
+		[[nodiscard]] size_t threadCount() const noexcept
+		{
+			return m_workers.size();
+		}
+
+		// Pool shared by everything which isn't given a specific executor
+		static ThreadPool& getDefault();
+
+	private:
+		struct Job
+		{
+			void (*run)(void* context, size_t begin, size_t end) = nullptr;
+			void* context = nullptr;
+			size_t grainSize = 1;
+			std::atomic<size_t> remaining = 0;
+
+			// First exception thrown by a chunk, after which the other chunks are skipped
+			std::atomic<bool> hasFailed = false;
+			std::mutex exceptionMutex;
+			std::exception_ptr exception;
+		};
+
+		struct Task
+		{
+			Job* job;
+			size_t begin;
+			size_t end;
+		};
+
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		void runJob(Job& job, const size_t count);
+		void workerLoop(const size_t queueIndex);
+
+		// Runs a task, splitting off halves for others to steal until it fits within the grain size
+		// Exceptions are kept in the job rather than thrown, as other threads may still be running its other halves
+		void execute(Task task, const size_t queueIndex) noexcept;
+
+		void push(const Task& task, const size_t queueIndex);
+		bool popLocal(Task& task, const size_t queueIndex);
+		bool steal(Task& task, const size_t queueIndex);
+
+		// Queue used by the calling thread, which is the thread's own queue for workers of this pool
+		size_t currentQueueIndex() const noexcept;
+
+	private:
+		std::vector<std::thread> m_workers;
+
+		// One queue per worker, followed by one shared by all other threads
+		std::vector<std::unique_ptr<Queue>> m_queues;
+
+		std::atomic<size_t> m_queuedTasks = 0;
+		std::mutex m_sleepMutex;
+		std::condition_variable m_wakeUp;
+		bool m_isStopping = false;
+	};
+}
@@ -0,0 +1,46 @@
+#include "pch_Utilities.hpp"
+#include "ThreadSlot.hpp"
+#include <bitset>
+#include <mutex>
+
+namespace Threading
+{
+	namespace
+	{
+		std::mutex s_slotMutex;
+		std::bitset<MAX_THREAD_SLOTS> s_takenSlots;
+
+		// Takes the lowest free slot when a thread first asks for one, and frees it when the thread exits
+		struct ThreadSlot
+		{
+			ThreadSlot()
+			{
+				std::lock_guard<std::mutex> lock(s_slotMutex);
+				while (index < MAX_THREAD_SLOTS && s_takenSlots.test(index))
+				{
+					index++;
+				}
+				if (index < MAX_THREAD_SLOTS)
+				{
+					s_takenSlots.set(index);
+				}
+			}
+			~ThreadSlot()
+			{
+				if (index < MAX_THREAD_SLOTS)
+				{
+					std::lock_guard<std::mutex> lock(s_slotMutex);
+					s_takenSlots.reset(index);
+				}
+			}
+
+			size_t index = 0;
+		};
+	}
+
+	size_t currentThreadSlot() noexcept
+	{
+		thread_local const ThreadSlot t_slot;
+		return t_slot.index;
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <cstddef>
+
+namespace Threading
+{
+	// Number of threads which can hold a slot at the same time, such as to push to an EventQueue or record Timer scopes without locking
+	constexpr size_t MAX_THREAD_SLOTS = 64;
+
+	// Returns the slot of the calling thread, which no other living thread has
+	// Slots are taken on the first call of a thread and freed when it exits. Returns MAX_THREAD_SLOTS if every slot is taken
+	size_t currentThreadSlot() noexcept;
+}
@@ -0,0 +1,430 @@
+#include "pch_Utilities.hpp"
+#include "Timer.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "Threading/ThreadSlot.hpp"
+
+namespace Timer
+{
+	namespace
+	{
+		// Scopes each thread can record between two calls to endFrame
+		constexpr std::uint32_t RING_CAPACITY = 1 << 15;
+
+		// Buckets cover every power of two with eight linear steps each
+		constexpr size_t SUB_BUCKETS = 8;
+		constexpr size_t BUCKET_COUNT = SUB_BUCKETS * 62;
+
+		struct Event
+		{
+			std::uint64_t start;
+			std::uint64_t end;
+			Label label;
+		};
+
+		// Written by one recording thread and read by endFrame, which only ever moves the tail up to the head
+		struct Ring
+		{
+			std::unique_ptr<Event[]> events = std::make_unique<Event[]>(RING_CAPACITY);
+			alignas(64) std::atomic<std::uint32_t> head{ 0 };
+			alignas(64) std::atomic<std::uint32_t> tail{ 0 };
+		};
+
+		struct Histogram
+		{
+			std::array<std::uint32_t, BUCKET_COUNT> buckets{};
+			std::uint64_t frames = 0;
+			std::uint64_t scopes = 0;
+			std::uint64_t total = 0;
+			std::uint64_t min = ~std::uint64_t(0);
+			std::uint64_t max = 0;
+		};
+
+		struct CounterTotals
+		{
+			CounterValues counters{};
+			std::uint64_t scopes = 0;
+			std::uint64_t entities = 0;
+		};
+
+		struct TraceEvent
+		{
+			Event event;
+			std::uint32_t thread;
+		};
+
+		// Everything which endFrame and report work on, created on first use so that scopes can be timed during static initialization
+		struct State
+		{
+			std::mutex mutex;
+
+			std::vector<std::string> labelNames;
+			std::unordered_map<std::string, Label> labels;
+
+			std::vector<std::unique_ptr<Ring>> rings;
+			std::vector<Histogram> histograms;
+			std::vector<CounterTotals> counterTotals;
+
+			// Time and scope count of each label in the frame being collected, and the labels which were recorded in it
+			std::vector<std::uint64_t> frameTicks;
+			std::vector<std::uint32_t> frameScopes;
+			std::vector<Label> frameLabels;
+
+			bool isTracing = false;
+			std::vector<TraceEvent> trace;
+		};
+
+		State& getState()
+		{
+			static State s_state;
+			return s_state;
+		}
+
+		// Rings by thread slot, created the first time a thread records and owned by the state
+		std::array<std::atomic<Ring*>, Threading::MAX_THREAD_SLOTS> s_rings{};
+
+		// Ring of the calling thread, which is looked up by slot once
+		thread_local Ring* t_ring = nullptr;
+
+		std::atomic<bool> s_isEnabled{ true };
+		std::atomic<std::uint64_t> s_droppedScopes{ 0 };
+
+		// Start of the measurement of ticks against the steady clock
+		const std::chrono::steady_clock::time_point s_originTime = std::chrono::steady_clock::now();
+		const std::uint64_t s_originTicks = now();
+
+		size_t bucketOf(const std::uint64_t ticks) noexcept
+		{
+			if (ticks < SUB_BUCKETS)
+			{
+				return static_cast<size_t>(ticks);
+			}
+
+			size_t exponent = 3;
+			while ((ticks >> (exponent + 1)) != 0)
+			{
+				exponent++;
+			}
+			const size_t bucket = (exponent - 2) * SUB_BUCKETS + static_cast<size_t>((ticks >> (exponent - 3)) & (SUB_BUCKETS - 1));
+			return std::min(bucket, BUCKET_COUNT - 1);
+		}
+
+		// Largest tick count which falls in a bucket
+		std::uint64_t bucketLimit(const size_t bucket) noexcept
+		{
+			if (bucket < SUB_BUCKETS)
+			{
+				return bucket;
+			}
+
+			const size_t exponent = bucket / SUB_BUCKETS + 2;
+			const std::uint64_t step = std::uint64_t(1) << (exponent - 3);
+			return (SUB_BUCKETS + bucket % SUB_BUCKETS) * step + (step - 1);
+		}
+
+		// Finds the ring of the calling thread's slot, which another thread may have used before, or creates it
+		// Returns null if the thread has no slot or the ring can't be allocated
+		Ring* findRing() noexcept
+		{
+			const size_t slot = Threading::currentThreadSlot();
+			if (slot >= Threading::MAX_THREAD_SLOTS)
+			{
+				return nullptr;
+			}
+
+			Ring* ring = s_rings[slot].load(std::memory_order_acquire);
+			if (ring)
+			{
+				return ring;
+			}
+
+			try
+			{
+				State& state = getState();
+				std::lock_guard<std::mutex> lock(state.mutex);
+				state.rings.push_back(std::make_unique<Ring>());
+				ring = state.rings.back().get();
+				s_rings[slot].store(ring, std::memory_order_release);
+				return ring;
+			}
+			catch (...)
+			{
+				return nullptr;
+			}
+		}
+
+		void writeEscaped(std::FILE* file, const std::string& text)
+		{
+			for (const char c : text)
+			{
+				if (c == '"' || c == '\\')
+				{
+					std::fputc('\\', file);
+					std::fputc(c, file);
+				}
+				else if (static_cast<unsigned char>(c) < 0x20)
+				{
+					std::fprintf(file, "\\u%04x", static_cast<unsigned int>(c));
+				}
+				else
+				{
+					std::fputc(c, file);
+				}
+			}
+		}
+	}
+
+	double nanosecondsPerTick()
+	{
+#ifdef TIMER_USES_TSC
+		// The measurement is only as precise as the time it spans, which is made long enough the first time
+		std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+		while (time - s_originTime < std::chrono::milliseconds(10))
+		{
+			time = std::chrono::steady_clock::now();
+		}
+		const std::uint64_t ticks = now();
+		return std::chrono::duration<double, std::nano>(time - s_originTime).count() / static_cast<double>(ticks - s_originTicks);
+#else
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::duration(1)).count();
+#endif
+	}
+
+	Label intern(const std::string& name)
+	{
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		const auto [it, isNew] = state.labels.try_emplace(name, static_cast<Label>(state.labelNames.size()));
+		if (isNew)
+		{
+			state.labelNames.push_back(name);
+		}
+		return it->second;
+	}
+	std::string labelName(const Label label)
+	{
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		return (label < state.labelNames.size() ? state.labelNames[label] : std::string());
+	}
+
+	void setEnabled(const bool isEnabled) noexcept
+	{
+		s_isEnabled.store(isEnabled, std::memory_order_relaxed);
+	}
+	bool isEnabled() noexcept
+	{
+		return s_isEnabled.load(std::memory_order_relaxed);
+	}
+
+	void record(const Label label, const std::uint64_t start, const std::uint64_t end) noexcept
+	{
+		if (!t_ring)
+		{
+			t_ring = findRing();
+			if (!t_ring)
+			{
+				s_droppedScopes.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+		}
+		Ring* ring = t_ring;
+
+		// Only this thread moves the head, and only endFrame moves the tail
+		const std::uint32_t head = ring->head.load(std::memory_order_relaxed);
+		if (head - ring->tail.load(std::memory_order_acquire) == RING_CAPACITY)
+		{
+			s_droppedScopes.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		ring->events[head % RING_CAPACITY] = { start, end, label };
+		ring->head.store(head + 1, std::memory_order_release);
+	}
+
+	void recordCounters(const Label label, const CounterValues& counters, const std::uint64_t entities)
+	{
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if (label >= state.counterTotals.size())
+		{
+			state.counterTotals.resize(static_cast<size_t>(label) + 1);
+		}
+
+		CounterTotals& totals = state.counterTotals[label];
+		for (size_t counter = 0; counter < COUNTER_COUNT; counter++)
+		{
+			totals.counters[counter] += counters[counter];
+		}
+		totals.scopes++;
+		totals.entities += entities;
+	}
+
+	void endFrame()
+	{
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.frameTicks.resize(state.labelNames.size(), 0);
+		state.frameScopes.resize(state.labelNames.size(), 0);
+
+		for (size_t slot = 0; slot < Threading::MAX_THREAD_SLOTS; slot++)
+		{
+			Ring* ring = s_rings[slot].load(std::memory_order_acquire);
+			if (!ring)
+			{
+				continue;
+			}
+
+			const std::uint32_t head = ring->head.load(std::memory_order_acquire);
+			std::uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+			for (; tail != head; tail++)
+			{
+				const Event& event = ring->events[tail % RING_CAPACITY];
+				if (event.label >= state.frameTicks.size())
+				{
+					continue;
+				}
+
+				if (state.frameScopes[event.label] == 0)
+				{
+					state.frameLabels.push_back(event.label);
+				}
+				state.frameTicks[event.label] += event.end - event.start;
+				state.frameScopes[event.label]++;
+
+				if (state.isTracing)
+				{
+					state.trace.push_back({ event, static_cast<std::uint32_t>(slot) });
+				}
+			}
+			ring->tail.store(tail, std::memory_order_release);
+		}
+
+		state.histograms.resize(state.labelNames.size());
+		for (const Label label : state.frameLabels)
+		{
+			const std::uint64_t ticks = state.frameTicks[label];
+			Histogram& histogram = state.histograms[label];
+			histogram.buckets[bucketOf(ticks)]++;
+			histogram.frames++;
+			histogram.scopes += state.frameScopes[label];
+			histogram.total += ticks;
+			histogram.min = std::min(histogram.min, ticks);
+			histogram.max = std::max(histogram.max, ticks);
+
+			state.frameTicks[label] = 0;
+			state.frameScopes[label] = 0;
+		}
+		state.frameLabels.clear();
+	}
+
+	std::vector<Stats> report()
+	{
+		const double msPerTick = nanosecondsPerTick() / 1e6;
+
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		std::vector<Stats> stats;
+		for (size_t label = 0; label < state.histograms.size(); label++)
+		{
+			const Histogram& histogram = state.histograms[label];
+			if (histogram.frames == 0)
+			{
+				continue;
+			}
+
+			// Smallest bucket which at least 99% of the frames fit in
+			const std::uint64_t p99Frames = (histogram.frames * 99 + 99) / 100;
+			std::uint64_t frames = 0;
+			size_t bucket = 0;
+			while (bucket + 1 < BUCKET_COUNT && (frames += histogram.buckets[bucket]) < p99Frames)
+			{
+				bucket++;
+			}
+			const std::uint64_t p99 = std::min(bucketLimit(bucket), histogram.max);
+
+			const CounterTotals totals = (label < state.counterTotals.size() ? state.counterTotals[label] : CounterTotals());
+			const std::uint64_t divisor = (totals.entities > 0 ? totals.entities : totals.scopes);
+			std::array<double, COUNTER_COUNT> counters{};
+			for (size_t counter = 0; counter < COUNTER_COUNT && divisor > 0; counter++)
+			{
+				counters[counter] = static_cast<double>(totals.counters[counter]) / static_cast<double>(divisor);
+			}
+
+			stats.push_back({ state.labelNames[label], histogram.frames, histogram.scopes,
+				static_cast<double>(histogram.total) * msPerTick,
+				static_cast<double>(histogram.min) * msPerTick,
+				static_cast<double>(histogram.total) / static_cast<double>(histogram.frames) * msPerTick,
+				static_cast<double>(p99) * msPerTick,
+				static_cast<double>(histogram.max) * msPerTick,
+				totals.scopes, totals.entities, counters });
+		}
+		return stats;
+	}
+
+	void reset()
+	{
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.histograms.clear();
+		state.counterTotals.clear();
+		state.trace.clear();
+	}
+
+	std::uint64_t droppedScopes() noexcept
+	{
+		return s_droppedScopes.load(std::memory_order_relaxed);
+	}
+
+	void setTracing(const bool isTracing)
+	{
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.isTracing = isTracing;
+	}
+
+	bool exportTrace(const std::string& path)
+	{
+		const double usPerTick = nanosecondsPerTick() / 1e3;
+
+		State& state = getState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+#ifdef _MSC_VER
+		std::FILE* file = nullptr;
+		if (fopen_s(&file, path.c_str(), "w") != 0)
+		{
+			file = nullptr;
+		}
+#else
+		std::FILE* file = std::fopen(path.c_str(), "w");
+#endif
+		if (!file)
+		{
+			return false;
+		}
+
+		// Times start from the first scope, which keeps them small enough to print precisely
+		std::uint64_t origin = ~std::uint64_t(0);
+		for (const TraceEvent& traceEvent : state.trace)
+		{
+			origin = std::min(origin, traceEvent.event.start);
+		}
+
+		std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+		for (size_t i = 0; i < state.trace.size(); i++)
+		{
+			const TraceEvent& traceEvent = state.trace[i];
+			std::fputs(i == 0 ? "\n{\"name\":\"" : ",\n{\"name\":\"", file);
+			writeEscaped(file, state.labelNames[traceEvent.event.label]);
+			std::fprintf(file, "\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", traceEvent.thread,
+				static_cast<double>(traceEvent.event.start - origin) * usPerTick, static_cast<double>(traceEvent.event.end - traceEvent.event.start) * usPerTick);
+		}
+		std::fputs("\n]}\n", file);
+
+		const bool isGood = (std::ferror(file) == 0);
+		return (std::fclose(file) == 0) && isGood;
+	}
+}
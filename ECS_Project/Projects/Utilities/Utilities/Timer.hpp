@@ -1,37 +1,164 @@
 #pragma once
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TIMER_USES_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TIMER_USES_TSC
+#endif
+
+/*
+	Profiler of nested scopes, cheap enough to be left on in hot paths such as systems and view iterations.
+
+	Scopes are named by labels, which are interned once up front, so timing a scope only reads a counter twice
+	and appends to a lock-free ring buffer of the calling thread. endFrame() collects every thread's buffer at a sync point,
+	and adds the time of each label during the frame to a histogram, which report() turns into min, average and 99th percentile frame times.
+	Scopes can also be kept for a Chrome trace (chrome://tracing or Perfetto), where nesting shows from the times of the scopes of each thread.
+
+	Events are dropped rather than waiting when a thread's buffer fills up between two calls to endFrame().
+*/
 namespace Timer
 {
-	using Storage = std::vector<std::pair<std::string, long long>>;
 	using Clock = std::chrono::high_resolution_clock;
 	using TimePoint = std::chrono::time_point<Clock>;
 
-	static Storage& getStorage()
+	// Index of an interned name
+	using Label = std::uint32_t;
+
+	// Ticks of the time stamp counter where there is one, or of the steady clock otherwise
+	inline std::uint64_t now() noexcept
 	{
-		static Storage s_instance;
-		return s_instance;
+#ifdef TIMER_USES_TSC
+		return __rdtsc();
+#else
+		return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
 	}
 
-	struct Scoped final
+	// Nanoseconds per tick of now(), measured against the steady clock
+	double nanosecondsPerTick();
+
+	// Returns the label of a name, which is the same each time the same name is passed
+	// Locks, which is why labels of hot scopes are interned once and kept, like PROFILE_SCOPE does
+	Label intern(const std::string& name);
+	std::string labelName(const Label label);
+
+	// Turns recording of new scopes on or off. On by default
+	void setEnabled(const bool isEnabled) noexcept;
+	[[nodiscard]] bool isEnabled() noexcept;
+
+	// Adds a scope which ended to the calling thread's buffer
+	void record(const Label label, const std::uint64_t start, const std::uint64_t end) noexcept;
+
+	// Collects the scopes recorded since the last call, and adds the time spent in each label to its histogram as one frame
+	// Must not be called from more than one thread at a time
+	void endFrame();
+
+	// Hardware events which CountedScope counts, see PerfCounters.hpp
+	enum class Counter
 	{
-		explicit Scoped(const char* str) : label(str), start(Clock::now()) { }
-		~Scoped() { getStorage().push_back({ label, (Clock::now() - start).count() }); }
+		Cycles,
+		Instructions,
+		L1DataMisses,
+		LastLevelMisses,
+		BranchMisses,
+		Count
+	};
+	constexpr size_t COUNTER_COUNT = static_cast<size_t>(Counter::Count);
+	using CounterValues = std::array<std::uint64_t, COUNTER_COUNT>;
 
-	public:
+	// Adds the hardware events of a counted scope, and the entities it visited, to the totals of its label
+	void recordCounters(const Label label, const CounterValues& counters, const std::uint64_t entities);
+
+	// Times of a label over the frames it was recorded in, where the time of a frame is that of every scope with the label added together
+	struct Stats
+	{
 		std::string label;
-		TimePoint start;
+		std::uint64_t frames;
+		std::uint64_t scopes;
+		double totalMs;
+		double minMs;
+		double averageMs;
+		// Upper bound of the histogram bucket, which is at most an eighth above the actual percentile
+		double p99Ms;
+		double maxMs;
+
+		// Scopes of the label which were counted, and the entities they visited
+		std::uint64_t countedScopes;
+		std::uint64_t entities;
+		// Hardware events per entity visited, or per counted scope if no entities were, indexed by Counter
+		std::array<double, COUNTER_COUNT> counters;
 	};
 
+	// Statistics of every label which was recorded, ordered by label
+	std::vector<Stats> report();
+
+	// Forgets every histogram, counter total and kept scope, but keeps the labels
+	void reset();
+
+	// Scopes which didn't fit in their thread's buffer, or were recorded by a thread without one
+	[[nodiscard]] std::uint64_t droppedScopes() noexcept;
+
+	// Keeps every scope collected by endFrame() while on, to be written by exportTrace
+	void setTracing(const bool isTracing);
+	// Writes the kept scopes as Chrome trace events in JSON. Returns false if the file can't be written
+	bool exportTrace(const std::string& path);
+
+	// Times the scope it lives in
+	struct Scoped final
+	{
+		explicit Scoped(const Label label) noexcept : m_label(label), m_start(isEnabled() ? now() : 0) {}
+		// Interns the name, which locks. Hot scopes should pass an interned label instead
+		explicit Scoped(const std::string& name) : Scoped(intern(name)) {}
+		Scoped(const Scoped& other) = delete;
+		~Scoped()
+		{
+			if (m_start != 0)
+			{
+				record(m_label, m_start, now());
+			}
+		}
+		Scoped& operator=(const Scoped& other) = delete;
+
+	private:
+		Label m_label;
+		std::uint64_t m_start;
+	};
+
+	// Times from its creation until stop() is called, once
 	struct Stopped final
 	{
-		explicit Stopped(const char* str) : label(str), start(Clock::now()) { }
-		void stop() { getStorage().push_back({ label, (Clock::now() - start).count() }); };
+		explicit Stopped(const Label label) noexcept : m_label(label), m_start(isEnabled() ? now() : 0) {}
+		explicit Stopped(const std::string& name) : Stopped(intern(name)) {}
 
-	public:
-		std::string label;
-		TimePoint start;
+		void stop() noexcept
+		{
+			if (m_start != 0)
+			{
+				record(m_label, m_start, now());
+				m_start = 0;
+			}
+		}
+
+	private:
+		Label m_label;
+		std::uint64_t m_start;
 	};
-};
\ No newline at end of file
+}
+
+#define TIMER_CONCATENATE_IMPL(a, b) a##b
+#define TIMER_CONCATENATE(a, b) TIMER_CONCATENATE_IMPL(a, b)
+
+// Times the rest of the enclosing scope under a name, which is interned the first time the scope runs
+// The names of the variables are numbered by __COUNTER__, which lets several scopes share a line
+#define PROFILE_SCOPE(name) PROFILE_SCOPE_NUMBERED(name, __COUNTER__)
+#define PROFILE_SCOPE_NUMBERED(name, number) \
+	static const Timer::Label TIMER_CONCATENATE(s_profileLabel, number) = Timer::intern(name); \
+	const Timer::Scoped TIMER_CONCATENATE(profileScope, number)(TIMER_CONCATENATE(s_profileLabel, number))